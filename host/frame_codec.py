@@ -0,0 +1,285 @@
+#!/usr/bin/env python3
+"""Encoder for the compressed frame stream (see software/Inc/frame_codec.h).
+
+Every encoding is tried on each frame and the smallest one is sent. DELTA
+needs the frame the device shows now, PALETTE can reuse the palette the
+device already holds : the Encoder object keeps both.
+
+Decoder mirrors the device's decoder in software/src/frame_codec.c, errors
+included. Run this file to check that encoded frames decode back to what
+was encoded, and that broken frames are rejected as on the device :
+
+    frame_codec.py [--count N]
+"""
+
+import argparse
+import random
+import struct
+
+RAW = 0x00
+RLE = 0x01
+DELTA = 0x02
+PALETTE = 0x03
+NAMES = {RAW: "raw", RLE: "rle", DELTA: "delta", PALETTE: "palette"}
+
+OP_RUN = 0x80
+OP_SKIP = 0xC0
+MAX_LITERAL = 128
+MAX_RUN = 64
+PALETTE_SIZE = 256
+PACKET = 64
+
+
+def _frame(encoding, payload):
+    return struct.pack("<BBH", encoding, 0, len(payload)) + payload
+
+
+def encode_ops(pixels, base):
+    """Literal, run and skip ops turning base into pixels."""
+    out = bytearray()
+    literal = []
+    n = len(pixels)
+    i = 0
+
+    def flush():
+        while literal:
+            chunk = literal[:MAX_LITERAL]
+            del literal[:MAX_LITERAL]
+            out.append(len(chunk) - 1)
+            out.extend(b"".join(chunk))
+
+    while i < n:
+        skip = 0
+        while i + skip < n and pixels[i + skip] == base[i + skip]:
+            skip += 1
+        run = 1
+        while i + run < n and pixels[i + run] == pixels[i]:
+            run += 1
+
+        if skip and skip >= run:
+            flush()
+            i += skip
+            # Trailing pixels that already match need no op at all
+            if i < n:
+                while skip:
+                    step = min(skip, MAX_RUN)
+                    out.append(OP_SKIP | (step - 1))
+                    skip -= step
+        elif run >= 2:
+            flush()
+            while run:
+                step = min(run, MAX_RUN)
+                out.append(OP_RUN | (step - 1))
+                out.extend(pixels[i])
+                i += step
+                run -= step
+        else:
+            literal.append(pixels[i])
+            i += 1
+
+    flush()
+    return bytes(out)
+
+
+class Encoder:
+    def __init__(self, channels):
+        self.channels = channels
+        self.previous = None
+        self.palette = None
+
+    def split(self, frame):
+        ch = self.channels
+        return [bytes(frame[i:i + ch]) for i in range(0, len(frame), ch)]
+
+    def candidates(self, frame):
+        pixels = self.split(frame)
+        black = [bytes(self.channels)] * len(pixels)
+        found = {RAW: _frame(RAW, bytes(frame)),
+                 RLE: _frame(RLE, encode_ops(pixels, black))}
+        if self.previous is not None and len(self.previous) == len(pixels):
+            found[DELTA] = _frame(DELTA, encode_ops(pixels, self.previous))
+
+        colours = sorted(set(pixels))
+        if len(colours) <= PALETTE_SIZE:
+            if self.palette is not None and set(colours) <= set(self.palette):
+                palette, table = self.palette, b""
+            else:
+                palette = colours
+                table = b"".join(palette)
+            index = {c: n for n, c in enumerate(palette)}
+            count = len(palette) if table else 0
+            payload = struct.pack("<H", count) + table + bytes(index[p] for p in pixels)
+            found[PALETTE] = (_frame(PALETTE, payload), palette)
+        return found
+
+    def encode(self, frame):
+        """Smallest encoding of a frame, padded to end in a short packet."""
+        found = self.candidates(frame)
+        size = {k: len(v[0] if k == PALETTE else v) for k, v in found.items()}
+        best = min(size, key=size.get)
+
+        data = found[best]
+        if best == PALETTE:
+            data, self.palette = data
+        self.previous = self.split(frame)
+
+        # The device ends a frame on a short packet
+        if len(data) % PACKET == 0:
+            data += b"\0"
+        return best, data
+
+    def reset(self):
+        self.previous = None
+        self.palette = None
+
+
+class DecodeError(Exception):
+    pass
+
+
+class Decoder:
+    """The device side : the strip shown and the palette held."""
+
+    def __init__(self, length, channels):
+        self.channels = channels
+        self.frame = bytes(length * channels)
+        self.palette = []
+
+    def decode(self, data):
+        """New strip contents, or DecodeError with the strip unchanged."""
+        if len(data) < 4:
+            raise DecodeError("short header")
+        encoding, reserved, size = struct.unpack("<BBH", data[:4])
+        payload = data[4:4 + size]
+        if reserved:
+            raise DecodeError("reserved byte")
+
+        # What did arrive is decoded first, as on the device : a cut palette
+        # is lost even though the frame is dropped
+        if encoding == RAW:
+            frame = bytearray(len(self.frame))
+            n = min(len(payload), len(frame))
+            frame[:n] = payload[:n]
+        elif encoding in (RLE, DELTA):
+            base = self.frame if encoding == DELTA else bytes(len(self.frame))
+            frame = self._ops(payload, bytearray(base))
+        elif encoding == PALETTE:
+            frame = self._palette(payload)
+        else:
+            raise DecodeError("unknown encoding")
+        if len(payload) < size:
+            raise DecodeError("truncated payload")
+
+        self.frame = bytes(frame)
+        return self.frame
+
+    def _put(self, frame, pos, pixel):
+        if pos + len(pixel) <= len(frame):
+            frame[pos:pos + len(pixel)] = pixel
+
+    def _ops(self, payload, frame):
+        ch = self.channels
+        pos = i = 0
+        while i < len(payload):
+            op = payload[i]
+            i += 1
+            if op < OP_RUN:
+                count = (op + 1) * ch
+                if i + count > len(payload):
+                    raise DecodeError("literal cut short")
+                for p in range(0, count, ch):
+                    self._put(frame, pos + p, payload[i + p:i + p + ch])
+                i += count
+                pos += count
+            elif op < OP_SKIP:
+                if i + ch > len(payload):
+                    raise DecodeError("run cut short")
+                for _ in range((op & 0x3F) + 1):
+                    self._put(frame, pos, payload[i:i + ch])
+                    pos += ch
+                i += ch
+            else:
+                pos += ((op & 0x3F) + 1) * ch
+        return frame
+
+    def _palette(self, payload):
+        ch = self.channels
+        if len(payload) < 2:
+            raise DecodeError("palette count cut short")
+        count = struct.unpack("<H", payload[:2])[0]
+        if count > PALETTE_SIZE:
+            raise DecodeError("palette too large")
+        i = 2
+        if count:
+            # The old palette is gone as soon as the new one starts
+            self.palette = []
+            table = payload[i:i + count * ch]
+            if len(table) < count * ch:
+                raise DecodeError("palette cut short")
+            self.palette = [table[n:n + ch] for n in range(0, len(table), ch)]
+            i += count * ch
+        elif not self.palette:
+            raise DecodeError("no palette")
+
+        frame = bytearray(len(self.frame))
+        black = bytes(ch)
+        for n, index in enumerate(payload[i:]):
+            entry = self.palette[index] if index < len(self.palette) else black
+            self._put(frame, n * ch, entry)
+        return frame
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--count", type=int, default=2000)
+    args = parser.parse_args()
+
+    rng = random.Random(0)
+    for channels in (3, 4):
+        length = 150
+        encoder = Encoder(channels)
+        decoder = Decoder(length, channels)
+        frame = bytearray(length * channels)
+        colours = [bytes(rng.randrange(256) for _ in range(channels))
+                   for _ in range(300)]
+        kinds = {}
+        for n in range(args.count):
+            # Mostly small edits, sometimes a new scene from few or many colours
+            if n % 50 == 0:
+                pool = colours[:rng.choice((2, 16, 300))]
+                frame = bytearray(b"".join(rng.choice(pool) for _ in range(length)))
+            else:
+                start = rng.randrange(length)
+                for p in range(start, min(length, start + rng.randrange(1, 20))):
+                    frame[p * channels:(p + 1) * channels] = rng.choice(colours[:16])
+            kind, data = encoder.encode(bytes(frame))
+            kinds[kind] = kinds.get(kind, 0) + 1
+            if decoder.decode(data) != bytes(frame):
+                raise SystemExit(f"{NAMES[kind]} frame {n} ({channels} channels) "
+                                 "does not decode back")
+        used = ", ".join(f"{NAMES[k]} {v}" for k, v in sorted(kinds.items()))
+        print(f"{channels} channels : {args.count} frames decode back ({used})")
+
+    # Broken frames are dropped, and a cut palette is not reused
+    decoder = Decoder(4, 3)
+    palette = _frame(PALETTE, struct.pack("<H", 2) + bytes(6) + bytes(4))
+    decoder.decode(palette)
+    broken = [_frame(RAW, b"")[:1] + b"\x01" + _frame(RAW, b"")[2:],
+              _frame(RLE, b"\x05\x00"),
+              palette[:8],
+              _frame(PALETTE, struct.pack("<H", 0) + bytes(4)),
+              b"\x09\x00\x00\x00"]
+    for n, data in enumerate(broken):
+        shown = decoder.frame
+        try:
+            decoder.decode(data)
+        except DecodeError:
+            if decoder.frame != shown:
+                raise SystemExit(f"broken frame {n} changed the strip")
+            continue
+        raise SystemExit(f"broken frame {n} was accepted")
+    print(f"{len(broken)} broken frames rejected")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,427 @@
+#!/usr/bin/env python3
+"""Host side of the Neopixel USB interfaces (needs pyusb, hidapi for HID).
+
+    neopixel_usb.py info
+    neopixel_usb.py fill R G B [--length N] [--sof-delay MS]
+    neopixel_usb.py bench [--frames N] [--length N] [--credits]
+    neopixel_usb.py stats [--clear]
+    neopixel_usb.py latency {bulk,hid} [--frames N]
+    neopixel_usb.py codec [--frames N] [--length N]
+    neopixel_usb.py stream --length N [--frames N]
+    neopixel_usb.py sof
+    neopixel_usb.py clock [--clear]
+
+Frames are written on the bulk OUT endpoint, R, G, B[, W] per pixel, one
+transfer per frame. The device NAKs while its back buffer is busy, so
+"bench" measures the sustained rate the strip and the endpoint accept.
+With --credits it paces itself on the status endpoint instead, writing a
+frame only once the device has a slot for it. Its "encode" line is the
+cycles per pixel the output engine spends encoding, e.g. the bit transpose
+of the parallel engine (checked against host/transpose.py), followed by the
+RAM and DMA transfers per pixel of that engine : run it on builds with
+different WS2812_OUTPUT to compare them.
+
+"latency" times a whole frame from the first byte written to the end of
+its latch on the strip, over the bulk endpoint (polling the frame counter)
+or the HID interface (waiting for the completion report).
+
+"codec" streams representative content (a static background with a small
+moving region and the odd scene change) as compressed frames, the encoder
+picking the smallest encoding per frame, and reports the compression and
+the device's decoding cost per frame.
+
+"stream" sends frames of N pixels in cut-through mode : the device feeds
+them to the wire through a small elastic buffer while they arrive, so N
+may exceed the frame buffer (single-strip engines). It reports the frame
+rate, the frames cut short because the host fell behind (underruns) and
+the fewest bytes the device had buffered ahead of the wire.
+
+"fill --sof-delay" shows the frame at a given USB frame number, read from
+the device then advanced by MS milliseconds : boards on the same bus given
+the same number latch together.
+
+"clock" reports the HSI48 trimming on SOF and the CPU clock error, which
+the WS2812 bit timing follows.
+"""
+
+import argparse
+import statistics
+import struct
+import sys
+import time
+
+import usb.core
+import usb.util
+
+import frame_codec
+
+VID = 0x1209
+PID = 0x0001
+INTERFACE = 0
+FRAME_EP = 0x01
+STATUS_EP = 0x86
+HID_INTERFACE = 3
+HID_CHUNK = 59
+HID_FLAG_PRESENT = 0x01
+HID_IN_FRAME_DONE = 0x01
+
+REQ_SET_LENGTH = 0x01
+REQ_SET_FORMAT = 0x02
+REQ_SET_BRIGHTNESS = 0x03
+REQ_SET_GAMMA = 0x04
+REQ_SET_DITHER = 0x05
+REQ_SET_PRESENT_AT = 0x06
+REQ_SET_ENCODING = 0x07
+REQ_SET_STREAM = 0x08
+REQ_GET_INFO = 0x10
+REQ_GET_STATS = 0x11
+REQ_GET_SOF = 0x12
+REQ_GET_CLOCK = 0x13
+REQ_GET_CREDITS = 0x14
+
+OUTPUTS = {0: "tim17", 1: "bsrr", 2: "dmar", 3: "spi"}
+
+OUT_VENDOR_IF = 0x41
+IN_VENDOR_IF = 0xC1
+
+
+class Device:
+    def __init__(self):
+        self.dev = usb.core.find(idVendor=VID, idProduct=PID)
+        if self.dev is None:
+            sys.exit("device not found")
+        self.dev.set_configuration()
+        usb.util.claim_interface(self.dev, INTERFACE)
+
+    def request(self, req, value):
+        self.dev.ctrl_transfer(OUT_VENDOR_IF, req, value, INTERFACE)
+
+    def info(self):
+        raw = bytes(self.dev.ctrl_transfer(IN_VENDOR_IF, REQ_GET_INFO, 0,
+                                           INTERFACE, 17))
+        max_pixels, length, channels, brightness, frames_done = \
+            struct.unpack("<HHBBI", raw[:10])
+        # Older firmware only has the single-strip TIM17 engine, 2-pixel ring
+        output, outputs, ring_bytes, dma_per_byte = \
+            struct.unpack("<BBHB", raw[10:15]) if len(raw) >= 15 else (0, 1, 64, 8)
+        stream_bytes = struct.unpack("<H", raw[15:17])[0] if len(raw) >= 17 else 0
+        return {"max_pixels": max_pixels, "length": length,
+                "channels": channels, "brightness": brightness,
+                "frames_done": frames_done,
+                "output": OUTPUTS.get(output, str(output)), "outputs": outputs,
+                "ring_bytes": ring_bytes, "dma_per_byte": dma_per_byte,
+                "stream_bytes": stream_bytes}
+
+    def stats(self, clear=False):
+        raw = bytes(self.dev.ctrl_transfer(IN_VENDOR_IF, REQ_GET_STATS, int(clear),
+                                           INTERFACE, 40))
+        keys = ("encode_cycles", "encode_pixels", "usb_cycles", "usb_bytes",
+                "decode_cycles", "decode_frames", "decode_errors",
+                "stream_frames", "stream_underruns", "stream_min_level")
+        # Older firmware stops at the decoder counters
+        stats = dict.fromkeys(keys, 0)
+        stats.update(zip(keys, struct.unpack(f"<{len(raw) // 4}I", raw)))
+        return stats
+
+    def sof(self):
+        raw = self.dev.ctrl_transfer(IN_VENDOR_IF, REQ_GET_SOF, 0, INTERFACE, 12)
+        return dict(zip(("count", "tick", "phase"), struct.unpack("<III", raw)))
+
+    def clock(self, clear=False):
+        raw = self.dev.ctrl_transfer(IN_VENDOR_IF, REQ_GET_CLOCK, int(clear),
+                                     INTERFACE, 22)
+        keys = ("sync_ok", "sync_warn", "sync_err", "hsi48_error",
+                "hsi48_error_max", "sysclk_ppm", "trim", "sysclk_hsi48")
+        return dict(zip(keys, struct.unpack("<IIIhHiBB", raw)))
+
+    def credits(self):
+        raw = self.dev.ctrl_transfer(IN_VENDOR_IF, REQ_GET_CREDITS, 0, INTERFACE, 12)
+        return self.parse_status(raw)
+
+    def status(self, timeout=1000):
+        return self.parse_status(self.dev.read(STATUS_EP, 16, timeout))
+
+    @staticmethod
+    def parse_status(raw):
+        keys = ("frames_received", "frame_limit", "frames_done")
+        return dict(zip(keys, struct.unpack("<III", bytes(raw))))
+
+    def set_encoding(self, compressed):
+        self.request(REQ_SET_ENCODING, int(compressed))
+
+    def set_stream(self, pixels):
+        self.request(REQ_SET_STREAM, pixels)
+
+    def present_at(self, frame_number):
+        self.request(REQ_SET_PRESENT_AT, frame_number & 0x7FF)
+
+    def set_length(self, pixels):
+        self.request(REQ_SET_LENGTH, pixels)
+
+    def write_frame(self, data, timeout=1000):
+        self.dev.write(FRAME_EP, data, timeout)
+
+
+def cmd_info(dev, args):
+    for key, value in dev.info().items():
+        print(f"{key}: {value}")
+
+
+def hid_open():
+    import hid
+
+    for entry in hid.enumerate(VID, PID):
+        if entry["interface_number"] == HID_INTERFACE:
+            dev = hid.device()
+            dev.open_path(entry["path"])
+            return dev
+    sys.exit("HID interface not found")
+
+
+def hid_send_frame(hid_dev, data, seq):
+    for offset in range(0, len(data), HID_CHUNK):
+        chunk = data[offset:offset + HID_CHUNK]
+        last = offset + HID_CHUNK >= len(data)
+        header = struct.pack("<BBBH", HID_FLAG_PRESENT if last else 0, seq,
+                             len(chunk), offset)
+        report = (header + chunk).ljust(64, b"\0")
+        hid_dev.write(b"\0" + report)   # no report ID
+
+
+def print_latency(samples):
+    samples = sorted(s * 1000 for s in samples)
+    print(f"{len(samples)} frames: min {samples[0]:.2f} ms, "
+          f"median {statistics.median(samples):.2f} ms, "
+          f"max {samples[-1]:.2f} ms")
+
+
+def cmd_latency(dev, args):
+    info = dev.info()
+    size = info["length"] * info["channels"]
+    samples = []
+
+    if args.path == "hid":
+        hid_dev = hid_open()
+        for n in range(args.frames):
+            seq = n & 0xFF
+            start = time.perf_counter()
+            hid_send_frame(hid_dev, bytes([n & 0xFF]) * size, seq)
+            while True:
+                report = hid_dev.read(64, 1000)
+                if not report:
+                    sys.exit("no completion report")
+                if report[0] == HID_IN_FRAME_DONE and report[1] == seq:
+                    break
+            samples.append(time.perf_counter() - start)
+    else:
+        for n in range(args.frames):
+            done = dev.info()["frames_done"]
+            start = time.perf_counter()
+            dev.write_frame(bytes([n & 0xFF]) * size)
+            while dev.info()["frames_done"] == done:
+                pass
+            samples.append(time.perf_counter() - start)
+
+    print_latency(samples)
+
+
+def print_output(info):
+    """Cost per pixel of the output engine, to compare builds."""
+    channels, length = info["channels"], max(1, info["length"])
+    # Two frame buffers and the dithering residue, per pixel of the chain
+    frame_ram = 3 * channels
+    dma = info["dma_per_byte"] * channels / info["outputs"]
+    print(f"output: {info['output']}, {info['outputs']} strip(s)")
+    print(f"ram: {frame_ram} bytes/pixel + ring {info['ring_bytes']} bytes "
+          f"({frame_ram + info['ring_bytes'] / length:.2f} bytes/pixel at {length})")
+    print(f"dma: {dma:.1f} transfers/pixel")
+
+
+def print_stats(stats, channels):
+    for key, value in stats.items():
+        print(f"{key}: {value}")
+    if stats["encode_pixels"]:
+        print(f"encode: {stats['encode_cycles'] / stats['encode_pixels']:.1f} cycles/pixel")
+    if stats["usb_bytes"]:
+        per_pixel = stats["usb_cycles"] * channels / stats["usb_bytes"]
+        print(f"usb receive: {per_pixel:.1f} cycles/pixel")
+    if stats["decode_frames"]:
+        per_frame = stats["decode_cycles"] / stats["decode_frames"]
+        print(f"decode: {per_frame:.0f} cycles/frame")
+    if stats["stream_frames"]:
+        print(f"stream: {stats['stream_underruns']} underruns in "
+              f"{stats['stream_frames']} frames, "
+              f"{stats['stream_min_level']} bytes slack at worst")
+
+
+def cmd_stats(dev, args):
+    print_stats(dev.stats(args.clear), dev.info()["channels"])
+
+
+def cmd_clock(dev, args):
+    clock = dev.clock(args.clear)
+    for key, value in clock.items():
+        print(f"{key}: {value}")
+    # One HSI48 cycle in a 1 ms SOF period is 1/48000
+    print(f"hsi48: {clock['hsi48_error'] * 1e6 / 48000:+.0f} ppm")
+
+
+def cmd_fill(dev, args):
+    if args.length is not None:
+        dev.set_length(args.length)
+    info = dev.info()
+    pixel = bytes([args.r, args.g, args.b, 0][:info["channels"]])
+    if args.sof_delay is not None:
+        target = dev.sof()["count"] + args.sof_delay
+        dev.present_at(target)
+        print(f"shown at SOF {target & 0x7FF}")
+    dev.write_frame(pixel * info["length"])
+
+
+def cmd_sof(dev, args):
+    for key, value in dev.sof().items():
+        print(f"{key}: {value}")
+
+
+def cmd_bench(dev, args):
+    if args.length is not None:
+        dev.set_length(args.length)
+    info = dev.info()
+    size = info["length"] * info["channels"]
+    frames = [bytes([(i + n) & 0xFF for i in range(size)]) for n in range(2)]
+
+    dev.stats(clear=True)
+    credits = dev.credits()
+    sent, limit = credits["frames_received"], credits["frame_limit"]
+    start = time.perf_counter()
+    for n in range(args.frames):
+        # The limit only grows : wait for the report granting this frame
+        while args.credits and sent >= limit:
+            limit = max(limit, dev.status()["frame_limit"])
+        dev.write_frame(frames[n & 1])
+        sent += 1
+    elapsed = time.perf_counter() - start
+
+    print(f"{args.frames} frames of {size} bytes in {elapsed:.3f} s")
+    print(f"{args.frames / elapsed:.1f} frames/s, "
+          f"{args.frames * size / elapsed / 1000:.1f} kB/s")
+    print_output(info)
+    print_stats(dev.stats(), info["channels"])
+
+
+def scene(n, length, channels):
+    """Frame n of a gradient background, a moving block and a cut every 100."""
+    base = (n // 100) * 40
+    frame = bytearray(((p + base + c * 85) & 0xFF) for p in range(length)
+                      for c in range(channels))
+    block = max(1, length // 20)
+    start = (n * 3) % max(1, length - block)
+    colour = bytes([255, n & 0xFF, 0, 0][:channels])
+    frame[start * channels:(start + block) * channels] = colour * block
+    return bytes(frame)
+
+
+def cmd_codec(dev, args):
+    if args.length is not None:
+        dev.set_length(args.length)
+    info = dev.info()
+    length, channels = info["length"], info["channels"]
+    encoder = frame_codec.Encoder(channels)
+    counts = {}
+    sent = 0
+
+    dev.set_encoding(True)
+    dev.stats(clear=True)
+    start = time.perf_counter()
+    try:
+        for n in range(args.frames):
+            kind, data = encoder.encode(scene(n, length, channels))
+            counts[kind] = counts.get(kind, 0) + 1
+            sent += len(data)
+            dev.write_frame(data)
+        elapsed = time.perf_counter() - start
+        stats = dev.stats()
+    finally:
+        dev.set_encoding(False)
+
+    raw = args.frames * length * channels
+    print(f"{args.frames} frames in {elapsed:.3f} s, {args.frames / elapsed:.1f} frames/s")
+    print(f"{sent} bytes sent for {raw} raw, ratio {raw / sent:.1f}")
+    for kind, count in sorted(counts.items()):
+        print(f"  {frame_codec.NAMES[kind]}: {count} frames")
+    print_stats(stats, channels)
+
+
+def cmd_stream(dev, args):
+    info = dev.info()
+    if not info["stream_bytes"]:
+        sys.exit(f"output {info['output']} cannot stream")
+    channels = info["channels"]
+    size = args.length * channels
+    frames = [bytes([(i + n) & 0xFF for i in range(size)]) for n in range(2)]
+
+    dev.set_stream(args.length)
+    dev.stats(clear=True)
+    start = time.perf_counter()
+    try:
+        for n in range(args.frames):
+            dev.write_frame(frames[n & 1], timeout=5000)
+        elapsed = time.perf_counter() - start
+        stats = dev.stats()
+    finally:
+        dev.set_stream(0)
+
+    print(f"{args.frames} frames of {args.length} pixels in {elapsed:.3f} s")
+    print(f"{args.frames / elapsed:.1f} frames/s, "
+          f"{args.frames * size / elapsed / 1000:.1f} kB/s, "
+          f"elastic buffer {info['stream_bytes']} bytes")
+    print_stats(stats, channels)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    sub = parser.add_subparsers(dest="cmd", required=True)
+
+    sub.add_parser("info")
+
+    fill = sub.add_parser("fill")
+    fill.add_argument("r", type=int)
+    fill.add_argument("g", type=int)
+    fill.add_argument("b", type=int)
+    fill.add_argument("--length", type=int)
+    fill.add_argument("--sof-delay", type=int)
+
+    bench = sub.add_parser("bench")
+    bench.add_argument("--frames", type=int, default=500)
+    bench.add_argument("--length", type=int)
+    bench.add_argument("--credits", action="store_true")
+
+    stats = sub.add_parser("stats")
+    stats.add_argument("--clear", action="store_true")
+
+    latency = sub.add_parser("latency")
+    latency.add_argument("path", choices=("bulk", "hid"))
+    latency.add_argument("--frames", type=int, default=100)
+
+    codec = sub.add_parser("codec")
+    codec.add_argument("--frames", type=int, default=500)
+    codec.add_argument("--length", type=int)
+
+    stream = sub.add_parser("stream")
+    stream.add_argument("--length", type=int, required=True)
+    stream.add_argument("--frames", type=int, default=100)
+
+    sub.add_parser("sof")
+    clock = sub.add_parser("clock")
+    clock.add_argument("--clear", action="store_true")
+
+    args = parser.parse_args()
+    dev = Device()
+    commands = {"info": cmd_info, "fill": cmd_fill, "bench": cmd_bench,
+                "stats": cmd_stats, "latency": cmd_latency, "sof": cmd_sof,
+                "clock": cmd_clock, "codec": cmd_codec, "stream": cmd_stream}
+    commands[args.cmd](dev, args)
+
+
+if __name__ == "__main__":
+    main()
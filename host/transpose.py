@@ -0,0 +1,72 @@
+#!/usr/bin/env python3
+"""Reference for the bit transpose of the parallel output engines.
+
+The device sends bit 7 of every strip, then bit 6, and so on : for each bit
+position k (0 = MSB first on the wire) the port word holds bit 7 - k of
+strip s in bit s. reference() builds these words one bit at a time ;
+kernel() mirrors WS2812_Transpose8x8() in software/Inc/ws2812_transpose.h,
+including its register layout, so the two can be checked against each
+other. Run it to check the kernel on random and corner-case inputs :
+
+    transpose.py [--count N]
+"""
+
+import argparse
+import random
+import struct
+
+MASK32 = 0xFFFFFFFF
+
+
+def reference(values):
+    """Port word of each of the 8 bit positions, from one byte per strip."""
+    return [sum(((v >> (7 - k)) & 1) << s for s, v in enumerate(values))
+            for k in range(8)]
+
+
+def transpose8x8(x, y):
+    """WS2812_Transpose8x8(), on 32-bit ints."""
+    t = (x ^ (x >> 7)) & 0x00AA00AA
+    x = (x ^ t ^ (t << 7)) & MASK32
+    t = (y ^ (y >> 7)) & 0x00AA00AA
+    y = (y ^ t ^ (t << 7)) & MASK32
+    t = (x ^ (x >> 14)) & 0x0000CCCC
+    x = (x ^ t ^ (t << 14)) & MASK32
+    t = (y ^ (y >> 14)) & 0x0000CCCC
+    y = (y ^ t ^ (t << 14)) & MASK32
+    t = (x & 0xF0F0F0F0) | ((y >> 4) & 0x0F0F0F0F)
+    y = ((x << 4) & 0xF0F0F0F0) | (y & 0x0F0F0F0F)
+    return t, y
+
+
+def kernel(values):
+    """Port words as the device computes them, 8 strips per transpose."""
+    words = [0] * 8
+    for group in range(0, len(values), 8):
+        chunk = bytes(values[group:group + 8]).ljust(8, b"\0")
+        y, x = struct.unpack("<II", chunk)
+        x, y = transpose8x8(x, y)
+        for k in range(4):
+            words[k] |= ((x >> (24 - 8 * k)) & 0xFF) << group
+            words[k + 4] |= ((y >> (24 - 8 * k)) & 0xFF) << group
+    return words
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--count", type=int, default=100000)
+    args = parser.parse_args()
+
+    cases = [[0] * 16, [0xFF] * 16, [1 << (s % 8) for s in range(16)]]
+    rng = random.Random(0)
+    cases += [[rng.randrange(256) for _ in range(rng.randrange(1, 17))]
+              for _ in range(args.count)]
+
+    for values in cases:
+        if kernel(values) != reference(values):
+            raise SystemExit(f"mismatch for {bytes(values).hex()}")
+    print(f"{len(cases)} cases, kernel matches the reference")
+
+
+if __name__ == "__main__":
+    main()
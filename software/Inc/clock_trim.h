@@ -0,0 +1,64 @@
+/**
+  ******************************************************************************
+  * @file    clock_trim.h
+  * @brief   HSI48 trimming on USB SOF (CRS) and clock error telemetry.
+  ******************************************************************************
+  * The clock recovery system compares HSI48 with the 1 kHz SOF of the host
+  * and trims it continuously, which keeps the USB clock within spec across
+  * temperature. With CLOCK_TRIM_SYSCLK_HSI48 the CPU and TIM17 run on that
+  * trimmed oscillator too, instead of the PLL on the untrimmed 8 MHz HSI, so
+  * the WS2812 bit timing follows the host crystal while USB is up. Without
+  * SOF (no host, suspend) HSI48 keeps its last trim.
+  *
+  * Two errors are reported : the HSI48 error the CRS measures at each SOF,
+  * and the SYSCLK error against SOF over about one second, which is the one
+  * the WS2812 bit timing sees whatever the clock source.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __CLOCK_TRIM_H
+#define __CLOCK_TRIM_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "main.h"
+
+/* Exported constants --------------------------------------------------------*/
+/* Run SYSCLK from the trimmed HSI48 rather than the PLL (both 48 MHz) */
+#ifndef CLOCK_TRIM_SYSCLK_HSI48
+#define CLOCK_TRIM_SYSCLK_HSI48 1
+#endif
+
+/* SOFs per SYSCLK error measurement */
+#define CLOCK_TRIM_WINDOW       1024U
+
+/* Exported types ------------------------------------------------------------*/
+/**
+  * @brief  Clock telemetry, little endian for the GET_CLOCK request
+  */
+typedef struct __attribute__((packed))
+{
+  uint32_t syncOk;          /* SOFs with HSI48 within the CRS error limit */
+  uint32_t syncWarn;        /* SOFs beyond it (trimmed by two steps) */
+  uint32_t syncErr;         /* Sync errors, missed syncs and trim overflows */
+  int16_t  hsi48Error;      /* HSI48 error at the last SOF, cycles per ms, > 0 fast */
+  uint16_t hsi48ErrorMax;   /* Largest |hsi48Error| since cleared */
+  int32_t  sysclkPpm;       /* SYSCLK error against SOF over the last window, > 0 fast */
+  uint8_t  trim;            /* CRS trim, 32 is the factory calibration */
+  uint8_t  sysclkHsi48;     /* 1 when SYSCLK runs on HSI48 */
+} ClockTrim_StatsTypeDef;
+
+/* Exported functions prototypes ---------------------------------------------*/
+void ClockTrim_Init(void);
+void ClockTrim_Sof(uint32_t count, uint32_t tick, uint32_t phase);
+void ClockTrim_GetStats(ClockTrim_StatsTypeDef *stats, uint8_t reset);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __CLOCK_TRIM_H */
@@ -0,0 +1,50 @@
+/**
+  ******************************************************************************
+  * @file    cycle_count.h
+  * @brief   CPU cycle measurement on the SysTick down-counter.
+  ******************************************************************************
+  * The Cortex-M0 has no cycle counter (DWT), but SysTick is clocked by HCLK
+  * and reloads every HAL tick, so the difference of two reads gives the
+  * cycles spent in between, for spans shorter than one tick (1 ms).
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __CYCLE_COUNT_H
+#define __CYCLE_COUNT_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "main.h"
+
+/* Exported functions --------------------------------------------------------*/
+/**
+  * @brief  Start a measurement.
+  * @retval Opaque start mark
+  */
+static inline uint32_t CycleCount_Now(void)
+{
+  return SysTick->VAL;
+}
+
+/**
+  * @brief  Cycles elapsed since a mark taken less than one tick ago.
+  * @param  start: mark returned by CycleCount_Now()
+  * @retval Cycles
+  */
+static inline uint32_t CycleCount_Since(uint32_t start)
+{
+  uint32_t now = SysTick->VAL;
+
+  /* SysTick counts down and wraps from 0 to LOAD */
+  return (start >= now) ? (start - now) : (start + SysTick->LOAD + 1U - now);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __CYCLE_COUNT_H */
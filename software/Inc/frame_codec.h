@@ -0,0 +1,72 @@
+/**
+  ******************************************************************************
+  * @file    frame_codec.h
+  * @brief   Streaming decoder for compressed pixel frames.
+  ******************************************************************************
+  * A frame is a 4-byte header, encoding, 0 (reserved, anything else is an
+  * error), payload length (2 bytes, little endian), then the payload. Pixels are in the frame buffer layout of the
+  * strip (channels bytes each). Encodings :
+  *
+  *   RAW      the pixels, the part of the strip not covered is turned off.
+  *   RLE      runs over a black strip. Each op byte is followed by its data :
+  *              0x00..0x7F  n + 1 literal pixels
+  *              0x80..0xBF  one pixel repeated (n & 0x3F) + 1 times
+  *              0xC0..0xFF  skip (n & 0x3F) + 1 pixels
+  *   DELTA    the same ops over the previous frame : skipped pixels keep
+  *            their value, so a static background costs one byte per 64
+  *            pixels and only the moving regions are sent.
+  *   PALETTE  entry count (2 bytes, little endian, 1..256, 0 keeps the last
+  *            palette), the entries (channels bytes each), then one index
+  *            per pixel. Pixels not covered are turned off. A palette is
+  *            only kept once all its entries are in : 0 is an error if the
+  *            last palette was cut short, or none was sent yet.
+  *
+  * Bytes may come in any chunking and are decoded in place into the frame.
+  * Pixels past the end of the strip are dropped. A payload that ends in the
+  * middle of an op, or an unknown encoding, is an error.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __FRAME_CODEC_H
+#define __FRAME_CODEC_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "main.h"
+
+/* Exported constants --------------------------------------------------------*/
+#define FRAME_CODEC_HEADER_LEN  4U
+
+#define FRAME_CODEC_RAW         0x00U
+#define FRAME_CODEC_RLE         0x01U
+#define FRAME_CODEC_DELTA       0x02U
+#define FRAME_CODEC_PALETTE     0x03U
+
+#define FRAME_CODEC_OP_SKIP     0xC0U
+#define FRAME_CODEC_OP_RUN      0x80U
+#define FRAME_CODEC_MAX_LITERAL 128U
+#define FRAME_CODEC_MAX_RUN     64U
+
+#define FRAME_CODEC_PALETTE_SIZE 256U
+
+/* Exported types ------------------------------------------------------------*/
+typedef enum
+{
+  FRAME_CODEC_BUSY = 0,   /* More payload expected */
+  FRAME_CODEC_DONE,       /* Frame complete, later bytes are ignored */
+  FRAME_CODEC_ERROR       /* Frame broken, later bytes are ignored */
+} FrameCodec_StatusTypeDef;
+
+/* Exported functions prototypes ---------------------------------------------*/
+void FrameCodec_Begin(uint8_t *dst, uint16_t pixels, uint8_t pixelChannels);
+FrameCodec_StatusTypeDef FrameCodec_Feed(const uint8_t *data, uint16_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __FRAME_CODEC_H */
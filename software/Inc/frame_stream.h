@@ -0,0 +1,74 @@
+/**
+  ******************************************************************************
+  * @file    frame_stream.h
+  * @brief   Elastic buffer between the bulk endpoint and a streamed frame.
+  ******************************************************************************
+  * In stream mode a frame is not gathered in the frame buffer : its bytes
+  * are pushed into a small FIFO as packets arrive, and the output engine
+  * pulls them through FrameStream_Fetch() while the frame is on the wire.
+  * The strip may then be far longer than WS2812_PIXELS, and the first pixel
+  * goes out once FRAME_STREAM_PREFILL bytes are in.
+  *
+  * One frame is in the FIFO at a time. The wire drains it at the strip's bit
+  * rate, the host fills it in bursts : the FIFO absorbs the gaps between
+  * them. If it runs dry mid-frame the rest of the frame is sent black, so
+  * that no pixel lands in the wrong place, and an underrun is counted. A
+  * frame ending early (short transfer) is padded with black, without error.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __FRAME_STREAM_H
+#define __FRAME_STREAM_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "main.h"
+
+/* Exported constants --------------------------------------------------------*/
+/* FIFO size, a power of two : 512 bytes hold 5 ms of a single strip */
+#ifndef FRAME_STREAM_BYTES
+#define FRAME_STREAM_BYTES      512U
+#endif
+
+/* Bytes received before the frame starts on the wire : more rides out
+   longer host gaps, at the cost of first-pixel latency */
+#ifndef FRAME_STREAM_PREFILL
+#define FRAME_STREAM_PREFILL    64U
+#endif
+
+#if ((FRAME_STREAM_BYTES & (FRAME_STREAM_BYTES - 1U)) != 0U)
+#error "FRAME_STREAM_BYTES must be a power of two"
+#endif
+#if (FRAME_STREAM_PREFILL > FRAME_STREAM_BYTES)
+#error "FRAME_STREAM_PREFILL larger than the FIFO"
+#endif
+
+/* Exported types ------------------------------------------------------------*/
+/**
+  * @brief  Stream counters
+  */
+typedef struct
+{
+  uint32_t underruns;   /* Frames cut short by an empty FIFO */
+  uint32_t minLevel;    /* Fewest bytes ahead of the wire, a measure of
+                           the slack left */
+} FrameStream_StatsTypeDef;
+
+/* Exported functions prototypes ---------------------------------------------*/
+void FrameStream_Begin(uint32_t bytes);
+uint8_t FrameStream_Reserve(uint32_t bytes);
+uint8_t FrameStream_Push(const uint8_t *data, uint32_t len, uint8_t last);
+uint32_t FrameStream_Level(void);
+const uint8_t *FrameStream_Fetch(uint32_t bytes);
+void FrameStream_GetStats(FrameStream_StatsTypeDef *stats, uint8_t reset);
+void FrameStream_RoomCallback(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __FRAME_STREAM_H */
@@ -59,7 +59,7 @@ void Error_Handler(void);
 /* USER CODE END EFP */
 
 /* Private defines -----------------------------------------------------------*/
-#define LED_CNT 60
+#define BIT_PERIOD 60
 
 /* USER CODE BEGIN Private defines */
 
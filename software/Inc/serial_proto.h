@@ -0,0 +1,37 @@
+/**
+  ******************************************************************************
+  * @file    serial_proto.h
+  * @brief   Streaming parser for the Adalight and tpm2 serial framings.
+  ******************************************************************************
+  * Adalight : 'A' 'd' 'a' count-1 (2 bytes, big endian) checksum, where the
+  *            checksum is hi ^ lo ^ 0x55, then count x R, G, B.
+  * tpm2     : 0xC9 type size (2 bytes, big endian) payload 0x36. Data frames
+  *            (type 0xDA) carry bytes in the frame buffer layout, other
+  *            packet types are skipped.
+  *
+  * Bytes may come in any chunking. Payload is written in place into the
+  * back buffer of the strip, and anything that does not parse is dropped up
+  * to the next start byte. A tpm2 frame without its end byte is not shown.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __SERIAL_PROTO_H
+#define __SERIAL_PROTO_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "main.h"
+
+/* Exported functions prototypes ---------------------------------------------*/
+void SerialProto_Reset(void);
+uint16_t SerialProto_Feed(const uint8_t *data, uint16_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __SERIAL_PROTO_H */
@@ -52,7 +52,12 @@ void SVC_Handler(void);
 void PendSV_Handler(void);
 void SysTick_Handler(void);
 void DMA1_Channel1_IRQHandler(void);
+void TIM17_IRQHandler(void);
+void USB_IRQHandler(void);
 /* USER CODE BEGIN EFP */
+void RCC_CRS_IRQHandler(void);
+void DMA1_Channel2_3_IRQHandler(void);
+void DMA1_Channel4_5_6_7_IRQHandler(void);
 
 /* USER CODE END EFP */
 
@@ -0,0 +1,47 @@
+/**
+  ******************************************************************************
+  * @file    usb_cdc.h
+  * @brief   CDC-ACM serial port feeding the Adalight / tpm2 parser.
+  ******************************************************************************
+  * The port shows up as a plain serial device (ttyACM, COMx) so ambilight
+  * software drives the strip directly. Line settings are accepted and
+  * ignored. "Ada\n" is sent when the host raises DTR, as Adalight firmwares
+  * do, for the hosts that wait for it.
+  *
+  * A received packet is parsed from its receive buffer straight into the
+  * strip's back buffer. While the strip cannot take the next frame the
+  * packet is held and the endpoint left NAKing, so the host is paced by the
+  * strip instead of losing bytes.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __USB_CDC_H
+#define __USB_CDC_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "usb_core.h"
+
+/* Exported constants --------------------------------------------------------*/
+#define USB_CDC_REQ_SET_LINE_CODING         0x20U
+#define USB_CDC_REQ_GET_LINE_CODING         0x21U
+#define USB_CDC_REQ_SET_CONTROL_LINE_STATE  0x22U
+#define USB_CDC_REQ_SEND_BREAK              0x23U
+
+/* Exported functions prototypes ---------------------------------------------*/
+void USB_Cdc_Configure(uint8_t config);
+void USB_Cdc_Setup(const USB_SetupTypeDef *req);
+void USB_Cdc_CtlOut(const USB_SetupTypeDef *req);
+void USB_Cdc_DataOut(uint8_t epnum);
+void USB_Cdc_DataIn(uint8_t epnum);
+void USB_Cdc_Poll(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __USB_CDC_H */
@@ -0,0 +1,129 @@
+/**
+  ******************************************************************************
+  * @file    usb_core.h
+  * @brief   Minimal USB device layer on top of the HAL PCD driver.
+  ******************************************************************************
+  * Handles enumeration on the control endpoint (standard requests, address,
+  * configuration) and hands class and vendor requests to the interfaces.
+  * Endpoints and their packet memory (PMA) are laid out here.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __USB_CORE_H
+#define __USB_CORE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "main.h"
+
+/* Exported constants --------------------------------------------------------*/
+#define USB_EP0_SIZE            64U
+
+/* Bulk OUT endpoint carrying pixel frames */
+#define USB_FRAME_EP            0x01U
+#define USB_FRAME_EP_SIZE       64U
+
+/* Interrupt IN endpoint reporting frame credits and completions */
+#define USB_FRAME_STATUS_EP     0x86U
+#define USB_FRAME_STATUS_EP_SIZE 16U
+
+/* CDC-ACM serial port : notification IN, data OUT and IN */
+#define USB_CDC_CMD_EP          0x82U
+#define USB_CDC_CMD_EP_SIZE     8U
+#define USB_CDC_OUT_EP          0x03U
+#define USB_CDC_IN_EP           0x83U
+#define USB_CDC_DATA_EP_SIZE    64U
+
+/* HID reports : 1 ms interrupt OUT and IN */
+#define USB_HID_OUT_EP          0x04U
+#define USB_HID_IN_EP           0x84U
+#define USB_HID_EP_SIZE         64U
+
+/* Isochronous OUT endpoint, one frame slice per millisecond */
+#define USB_ISO_EP              0x05U
+#define USB_ISO_EP_SIZE         192U
+
+/* Packet memory plan (1 KB, byte offsets) :
+     0x000  buffer table, 8 endpoints x 8 bytes
+     0x040  EP0 OUT
+     0x080  EP0 IN
+     0x0C0  frame endpoint, buffer 0
+     0x100  frame endpoint, buffer 1
+     0x140  CDC notification IN
+     0x150  CDC data OUT
+     0x190  CDC data IN
+     0x1D0  HID OUT
+     0x210  HID IN
+     0x250  isochronous OUT, buffer 0
+     0x310  isochronous OUT, buffer 1
+     0x3D0  frame status IN
+   The frame endpoint is double buffered : the hardware ACKs the next packet
+   into one buffer while the firmware is still copying the other out. The
+   isochronous endpoint is double buffered as the hardware requires. */
+#define USB_PMA_SIZE            0x400U
+#define USB_PMA_EP0_OUT         0x40U
+#define USB_PMA_EP0_IN          0x80U
+#define USB_PMA_FRAME_EP_BUF0   0xC0U
+#define USB_PMA_FRAME_EP_BUF1   0x100U
+#define USB_PMA_CDC_CMD         0x140U
+#define USB_PMA_CDC_OUT         0x150U
+#define USB_PMA_CDC_IN          0x190U
+#define USB_PMA_HID_OUT         0x1D0U
+#define USB_PMA_HID_IN          0x210U
+#define USB_PMA_ISO_BUF0        0x250U
+#define USB_PMA_ISO_BUF1        0x310U
+#define USB_PMA_FRAME_STATUS    0x3D0U
+#define USB_PMA_END             0x3E0U
+
+#if (USB_PMA_END > USB_PMA_SIZE)
+#error "Endpoint buffers do not fit in the packet memory"
+#endif
+
+/* bmRequestType fields */
+#define USB_REQ_DIR_IN          0x80U
+#define USB_REQ_TYPE_MASK       0x60U
+#define USB_REQ_TYPE_STANDARD   0x00U
+#define USB_REQ_TYPE_CLASS      0x20U
+#define USB_REQ_TYPE_VENDOR     0x40U
+#define USB_REQ_RECIP_MASK      0x1FU
+#define USB_REQ_RECIP_DEVICE    0x00U
+#define USB_REQ_RECIP_INTERFACE 0x01U
+#define USB_REQ_RECIP_ENDPOINT  0x02U
+
+/* Exported macro ------------------------------------------------------------*/
+#define LOBYTE(x)               ((uint8_t)((x) & 0x00FFU))
+#define HIBYTE(x)               ((uint8_t)(((x) & 0xFF00U) >> 8U))
+
+/* Exported types ------------------------------------------------------------*/
+/**
+  * @brief  SETUP packet
+  */
+typedef struct
+{
+  uint8_t  bmRequestType;
+  uint8_t  bRequest;
+  uint16_t wValue;
+  uint16_t wIndex;
+  uint16_t wLength;
+} USB_SetupTypeDef;
+
+/* Exported variables --------------------------------------------------------*/
+extern PCD_HandleTypeDef hpcd_USB_FS;
+
+/* Exported functions prototypes ---------------------------------------------*/
+void USB_Core_Init(void);
+uint8_t USB_Core_IsConfigured(void);
+void USB_Core_CtlSend(const uint8_t *data, uint16_t len);
+void USB_Core_CtlReceive(uint8_t *data, uint16_t len);
+void USB_Core_CtlStatus(void);
+void USB_Core_CtlError(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __USB_CORE_H */
@@ -0,0 +1,49 @@
+/**
+  ******************************************************************************
+  * @file    usb_desc.h
+  * @brief   USB descriptors of the controller.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __USB_DESC_H
+#define __USB_DESC_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "main.h"
+
+/* Exported constants --------------------------------------------------------*/
+/* pid.codes test VID/PID, to be replaced by an allocated pair */
+#define USB_VID                 0x1209U
+#define USB_PID                 0x0001U
+
+#define USB_DESC_DEVICE         0x01U
+#define USB_DESC_CONFIGURATION  0x02U
+#define USB_DESC_STRING         0x03U
+#define USB_DESC_INTERFACE      0x04U
+#define USB_DESC_ENDPOINT       0x05U
+#define USB_DESC_IAD            0x0BU
+#define USB_DESC_HID            0x21U
+#define USB_DESC_HID_REPORT     0x22U
+#define USB_DESC_CS_INTERFACE   0x24U
+
+/* Interface numbers */
+#define USB_FRAME_INTERFACE     0U
+#define USB_CDC_COMM_INTERFACE  1U
+#define USB_CDC_DATA_INTERFACE  2U
+#define USB_HID_INTERFACE       3U
+#define USB_ISO_INTERFACE       4U
+#define USB_NUM_INTERFACES      5U
+
+/* Exported functions prototypes ---------------------------------------------*/
+const uint8_t *USB_Desc_Get(uint8_t type, uint8_t index, uint16_t *len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __USB_DESC_H */
@@ -0,0 +1,167 @@
+/**
+  ******************************************************************************
+  * @file    usb_frame.h
+  * @brief   Vendor interface streaming pixel frames to the WS2812 driver.
+  ******************************************************************************
+  * The host writes one frame per bulk OUT transfer on USB_FRAME_EP, in the
+  * frame buffer layout (R, G, B[, W] per pixel, length x channels bytes).
+  * Packets land straight in the driver's back buffer and the frame is
+  * presented when the transfer ends, a short transfer ending it early.
+  * The endpoint is only armed while the back buffer is free, so the host is
+  * NAKed, not dropped, when it sends faster than the strip refreshes.
+  * Bytes past length x channels are dropped : the last, partial packet of a
+  * frame is received aside and only its frame part copied, since the double
+  * buffered endpoint always copies whole packets.
+  *
+  * With SET_ENCODING 1 each transfer carries one compressed frame instead
+  * (frame_codec.h), decoded into the back buffer as its packets arrive. The
+  * transfer must end on a short packet, padded with a byte if needed : a
+  * frame that is not complete by then is dropped.
+  *
+  * With SET_STREAM n (cut-through) each transfer is a frame of n pixels,
+  * which may exceed WS2812_PIXELS. Its packets go through a small elastic
+  * buffer (frame_stream.h) and the frame starts on the wire as soon as
+  * FRAME_STREAM_PREFILL bytes are in, while the rest is still arriving. The
+  * host must keep ahead of the strip : the buffer is NAKed when full, and if
+  * it runs dry the rest of the frame is sent black and counted in GET_STATS.
+  * A short packet ends the frame, padded with black ; do not send a zero
+  * length packet after a frame of a whole number of packets. Single-strip
+  * engines only. Dithering would keep the strip busy for good : SET_STREAM
+  * stalls while it is on, and SET_DITHER 1 while streaming. SET_PRESENT_AT
+  * stalls while streaming too. A frame from another interface delays the
+  * streamed one, whose packets are then NAKed until the strip is free.
+  *
+  * Flow control : USB_FRAME_STATUS_EP sends a USB_FrameStatusTypeDef report
+  * whenever its counters change, among them once per frame latched. The
+  * host may send bulk frame number n (counted from 0 since the configuration
+  * was selected) once n < frameLimit : it then always has the next frame
+  * ready to go without ever being NAKed mid-frame, and never needs to sleep.
+  * GET_CREDITS returns the same report, to start from. SET_LENGTH,
+  * SET_FORMAT, SET_ENCODING and SET_STREAM drop a frame in progress, so send
+  * them with no frame pending.
+  *
+  * Other interfaces borrow the back buffer frame by frame through
+  * USB_Frame_Acquire() / USB_Frame_Submit(), so one source drives the strip
+  * at a time and every one of them writes the frame buffer in place.
+  *
+  * Vendor requests (bmRequestType 0x41, wIndex = USB_FRAME_INTERFACE) :
+  *   SET_LENGTH     wValue = pixels on the strip
+  *   SET_FORMAT     wValue = USB_FRAME_FORMAT_xxx
+  *                  Both stall while a frame is queued, and apply from the
+  *                  next frame start (dithering included)
+  *   SET_BRIGHTNESS wValue = 0..255
+  *   SET_GAMMA      wValue = USB_FRAME_GAMMA_xxx
+  *   SET_DITHER     wValue = 0 or 1, 1 stalls in stream mode
+  *   SET_ENCODING   wValue = 0 raw frames, 1 compressed frames
+  *   SET_STREAM     wValue = pixels per streamed frame, 0 back to buffered ;
+  *                  stalls while dithering
+  *   SET_PRESENT_AT wValue = USB frame number (11 bits) : the next bulk frame
+  *                  is held and shown at that SOF, see usb_sof.h. The strip
+  *                  must be idle by then (no dithering), or it is queued.
+  *   GET_INFO       (0xC1) returns USB_FrameInfoTypeDef
+  *   GET_STATS      (0xC1) returns USB_FrameStatsTypeDef, wValue = 1 clears
+  *   GET_SOF        (0xC1) returns USB_SofStampTypeDef, the last SOF seen
+  *   GET_CLOCK      (0xC1) returns ClockTrim_StatsTypeDef, wValue = 1 clears
+  *   GET_CREDITS    (0xC1) returns USB_FrameStatusTypeDef
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __USB_FRAME_H
+#define __USB_FRAME_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "usb_core.h"
+
+/* Exported constants --------------------------------------------------------*/
+#define USB_FRAME_REQ_SET_LENGTH      0x01U
+#define USB_FRAME_REQ_SET_FORMAT      0x02U
+#define USB_FRAME_REQ_SET_BRIGHTNESS  0x03U
+#define USB_FRAME_REQ_SET_GAMMA       0x04U
+#define USB_FRAME_REQ_SET_DITHER      0x05U
+#define USB_FRAME_REQ_SET_PRESENT_AT  0x06U
+#define USB_FRAME_REQ_SET_ENCODING    0x07U
+#define USB_FRAME_REQ_SET_STREAM      0x08U
+#define USB_FRAME_REQ_GET_INFO        0x10U
+#define USB_FRAME_REQ_GET_STATS       0x11U
+#define USB_FRAME_REQ_GET_SOF         0x12U
+#define USB_FRAME_REQ_GET_CLOCK       0x13U
+#define USB_FRAME_REQ_GET_CREDITS     0x14U
+
+#define USB_FRAME_FORMAT_GRB          0x00U
+#define USB_FRAME_FORMAT_RGB          0x01U
+#define USB_FRAME_FORMAT_BRG          0x02U
+#define USB_FRAME_FORMAT_GRBW         0x03U
+
+#define USB_FRAME_GAMMA_LINEAR        0x00U
+#define USB_FRAME_GAMMA_28            0x01U
+
+/* Exported types ------------------------------------------------------------*/
+/**
+  * @brief  GET_INFO reply, little endian
+  */
+typedef struct __attribute__((packed))
+{
+  uint16_t maxPixels;   /* WS2812_PIXELS */
+  uint16_t length;      /* Current strip length */
+  uint8_t  channels;    /* Bytes per pixel of the current format */
+  uint8_t  brightness;
+  uint32_t framesDone;  /* Frames latched since reset */
+  uint8_t  output;      /* WS2812_OUTPUT engine */
+  uint8_t  outputs;     /* Strips driven in parallel */
+  uint16_t ringBytes;   /* Encoding RAM of the output engine */
+  uint8_t  dmaPerByte;  /* DMA transfers per colour byte of all strips */
+  uint16_t streamBytes; /* Elastic buffer of SET_STREAM, 0 if unsupported */
+} USB_FrameInfoTypeDef;
+
+/**
+  * @brief  GET_STATS reply, little endian : CPU cost of each stage
+  */
+typedef struct __attribute__((packed))
+{
+  uint32_t encodeCycles;  /* Ring refills */
+  uint32_t encodePixels;
+  uint32_t usbCycles;     /* USB interrupt, control traffic and refills
+                             preempting it included */
+  uint32_t usbBytes;      /* Frame bytes received */
+  uint32_t decodeCycles;  /* Decoding compressed frames */
+  uint32_t decodeFrames;  /* Compressed frames shown */
+  uint32_t decodeErrors;  /* Compressed frames dropped */
+  uint32_t streamFrames;  /* Streamed frames started on the wire */
+  uint32_t streamUnderruns; /* Streamed frames cut short, rest sent black */
+  uint32_t streamMinLevel;  /* Fewest bytes buffered ahead of the wire */
+} USB_FrameStatsTypeDef;
+
+/**
+  * @brief  Status report and GET_CREDITS reply, little endian
+  */
+typedef struct __attribute__((packed))
+{
+  uint32_t framesReceived;  /* Bulk frames received since configured */
+  uint32_t frameLimit;      /* Bulk frames the host may have sent : received
+                               plus the free frame slots */
+  uint32_t framesDone;      /* Frames latched since reset, from any interface */
+} USB_FrameStatusTypeDef;
+
+/* Exported functions prototypes ---------------------------------------------*/
+void USB_Frame_Configure(uint8_t config);
+void USB_Frame_Setup(const USB_SetupTypeDef *req);
+void USB_Frame_CtlOut(const USB_SetupTypeDef *req);
+void USB_Frame_DataOut(uint8_t epnum);
+void USB_Frame_DataIn(uint8_t epnum);
+void USB_Frame_Poll(void);
+void USB_Frame_Arm(void);
+uint8_t *USB_Frame_Acquire(void);
+void USB_Frame_Submit(uint8_t present, uint32_t *fence);
+void USB_Frame_AccountIrq(uint32_t cycles);
+void USB_Frame_Sof(uint16_t frameNumber);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __USB_FRAME_H */
@@ -0,0 +1,64 @@
+/**
+  ******************************************************************************
+  * @file    usb_hid.h
+  * @brief   Vendor-defined HID interface taking chunked pixel updates.
+  ******************************************************************************
+  * Every OS binds HID without a driver, and interrupt endpoints get a
+  * reserved slot in each 1 ms USB frame. A 64-byte output report writes one
+  * chunk of the frame buffer :
+  *   [0]     flags, USB_HID_FLAG_xxx
+  *   [1]     sequence number, echoed when the frame is shown
+  *   [2]     data length, up to USB_HID_CHUNK_MAX
+  *   [3..4]  byte offset in the frame buffer, little endian
+  *   [5..63] data, in the frame buffer layout (R, G, B[, W] per pixel)
+  * The first chunk of a frame starts from the frame last shown, so a report
+  * may update a part of the strip only. The chunk flagged PRESENT shows the
+  * frame ; once it is latched an input report comes back :
+  *   [0]     USB_HID_IN_FRAME_DONE
+  *   [1]     sequence number of the PRESENT report
+  *   [2..5]  frames latched since reset, little endian
+  * GET_REPORT (input) returns the last input report sent.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __USB_HID_H
+#define __USB_HID_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "usb_core.h"
+
+/* Exported constants --------------------------------------------------------*/
+#define USB_HID_REQ_GET_REPORT      0x01U
+#define USB_HID_REQ_GET_IDLE        0x02U
+#define USB_HID_REQ_GET_PROTOCOL    0x03U
+#define USB_HID_REQ_SET_REPORT      0x09U
+#define USB_HID_REQ_SET_IDLE        0x0AU
+#define USB_HID_REQ_SET_PROTOCOL    0x0BU
+
+/* GET_REPORT report type, wValue high byte */
+#define USB_HID_REPORT_INPUT        0x01U
+
+#define USB_HID_HEADER_SIZE         5U
+#define USB_HID_CHUNK_MAX           (USB_HID_EP_SIZE - USB_HID_HEADER_SIZE)
+
+#define USB_HID_FLAG_PRESENT        0x01U
+
+#define USB_HID_IN_FRAME_DONE       0x01U
+
+/* Exported functions prototypes ---------------------------------------------*/
+void USB_Hid_Configure(uint8_t config);
+void USB_Hid_Setup(const USB_SetupTypeDef *req);
+void USB_Hid_DataOut(uint8_t epnum);
+void USB_Hid_DataIn(uint8_t epnum);
+void USB_Hid_Poll(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __USB_HID_H */
@@ -0,0 +1,50 @@
+/**
+  ******************************************************************************
+  * @file    usb_iso.h
+  * @brief   Isochronous frame interface, rate-locked to the USB frame clock.
+  ******************************************************************************
+  * Alternate setting 1 of the interface opens an isochronous OUT endpoint :
+  * its bandwidth is reserved by the host, so a slice arrives in every 1 ms
+  * USB frame whatever the bus load. Each packet carries :
+  *   [0]     frame sequence number
+  *   [1]     slice index, USB_ISO_SLICE_LAST set on the last slice
+  *   [2..3]  USB frame number (SOF count, 11 bits) at which to show the
+  *           frame, little endian
+  *   [4..]   up to USB_ISO_SLICE bytes of the frame buffer, from
+  *           index x USB_ISO_SLICE
+  * The frame is shown at the first SOF at or after the requested number,
+  * so the host-to-light latency is set by the host, not by bus traffic.
+  * Isochronous data is never retried : a lost slice keeps the content of
+  * the frame shown before. Slices of the next frame must not be sent
+  * before the requested SOF, they are dropped while a frame is waiting.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __USB_ISO_H
+#define __USB_ISO_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "usb_core.h"
+
+/* Exported constants --------------------------------------------------------*/
+#define USB_ISO_HEADER_SIZE     4U
+#define USB_ISO_SLICE           (USB_ISO_EP_SIZE - USB_ISO_HEADER_SIZE)
+#define USB_ISO_SLICE_LAST      0x80U
+
+/* Exported functions prototypes ---------------------------------------------*/
+void USB_Iso_Configure(uint8_t config);
+HAL_StatusTypeDef USB_Iso_SetAlt(uint8_t alt);
+uint8_t USB_Iso_GetAlt(void);
+void USB_Iso_DataOut(uint8_t epnum);
+void USB_Iso_Sof(uint16_t frameNumber);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __USB_ISO_H */
@@ -0,0 +1,54 @@
+/**
+  ******************************************************************************
+  * @file    usb_sof.h
+  * @brief   USB start-of-frame timestamps and SOF-timed presentation.
+  ******************************************************************************
+  * Every board on a bus sees the same SOF at the same instant (within the
+  * hub delays), which makes the host frame counter a shared clock. SOF is
+  * handled at the very top of the USB interrupt, before the HAL processes
+  * packets, so a frame scheduled for a given SOF starts on the wire a fixed
+  * delay after it : boards with strips of the same length latch together
+  * without any sync wire. The delay only varies when SOF comes while the USB
+  * interrupt is already running, or while interrupts are masked.
+  *
+  * Each SOF is also timestamped against the local clock (HAL tick and
+  * SysTick phase) and counted on 32 bits, for the host to check the timing.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __USB_SOF_H
+#define __USB_SOF_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "usb_core.h"
+
+/* Exported constants --------------------------------------------------------*/
+#define USB_SOF_NUMBER_MASK     0x07FFU
+
+/* Exported types ------------------------------------------------------------*/
+/**
+  * @brief  Last SOF seen, little endian for the GET_SOF request
+  */
+typedef struct __attribute__((packed))
+{
+  uint32_t count;       /* SOFs since reset, the low 11 bits being the frame number */
+  uint32_t tick;        /* HAL tick (ms) when it was handled */
+  uint32_t phase;       /* CPU cycles into that tick */
+} USB_SofStampTypeDef;
+
+/* Exported functions prototypes ---------------------------------------------*/
+void USB_Sof_IrqEntry(void);
+void USB_Sof_Reset(void);
+void USB_Sof_GetStamp(USB_SofStampTypeDef *stamp);
+uint8_t USB_Sof_Reached(uint16_t frameNumber, uint16_t target);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __USB_SOF_H */
@@ -0,0 +1,227 @@
+/**
+  ******************************************************************************
+  * @file    ws2812.h
+  * @brief   WS2812 streaming driver.
+  ******************************************************************************
+  * The colours live in a compact frame buffer (3 or 4 bytes per pixel). Only a
+  * small circular ring of encoded bits is kept in RAM : the DMA half-transfer
+  * and transfer-complete interrupts re-encode the half that was just sent from
+  * the frame buffer, so the encoding RAM no longer depends on the strip length.
+  *
+  * Two output engines are available, chosen at build time with WS2812_OUTPUT :
+  *   WS2812_OUTPUT_TIM17  one strip on TIM17 CH1 (PB9), PWM compare values
+  *                        streamed by DMA1 Channel1.
+  *   WS2812_OUTPUT_BSRR   WS2812_BSRR_STRIPS strips in parallel on consecutive
+  *                        pins of one port, clocked by TIM2 whose three DMA
+  *                        requests per bit write the port BSRR / BRR. The
+  *                        chain is split evenly across the strips, so a frame
+  *                        takes 1 / WS2812_BSRR_STRIPS of the time.
+  *   WS2812_OUTPUT_DMAR   4 strips on TIM3 CH1..CH4 (PA6, PA7, PB0, PB1), the
+  *                        four compare values of each bit written by one DMA
+  *                        burst through TIM3->DMAR. Hardware PWM edges, the
+  *                        chain split in four.
+  *   WS2812_OUTPUT_SPI    one strip on SPI1 MOSI (PB5), each bit sent as a
+  *                        3 or 4-bit symbol (WS2812_SPI_SYMBOL_BITS), so 9 or
+  *                        12 DMA bytes per RGB pixel instead of 24. Leaves
+  *                        TIM17 free.
+  *
+  * Frames are double buffered : SetPixel/Fill draw into the back buffer and
+  * WS2812_Present() queues it. The buffers are swapped at the latch boundary,
+  * so a frame on the wire is never modified. After a swap the back buffer
+  * holds the frame before last, not the one just presented.
+  *
+  * WS2812_PresentStream() bypasses the buffers : the engine pulls the frame
+  * from a source as it goes, so the chain may be longer than WS2812_PIXELS.
+  * Single-strip engines only, the parallel ones read the chain out of order.
+  *
+  * The frame buffer always holds R, G, B (and W) in that order. The pixel
+  * format of the strip gives the wire order and the channel count, and is
+  * applied by the encoder, together with the gamma curve, the global
+  * brightness and optional temporal dithering. Like the levels, a new
+  * length or format applies from the next frame start, also while dithering
+  * keeps re-sending the front buffer ; it is refused while a frame is queued,
+  * since that frame was drawn for the old layout.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __WS2812_H
+#define __WS2812_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "main.h"
+#include "ws2812_profiles.h"
+
+/* Exported constants --------------------------------------------------------*/
+/* Number of pixels held in the frame buffer (longest strip supported) */
+#ifndef WS2812_PIXELS
+#define WS2812_PIXELS           300U
+#endif
+
+/* Widest pixel format supported : 4 for RGBW strips, 3 saves RAM */
+#ifndef WS2812_MAX_CHANNELS
+#define WS2812_MAX_CHANNELS     4U
+#endif
+
+/* Frame buffer size, RGB strips fit WS2812_FRAME_BYTES / 3 pixels */
+#define WS2812_FRAME_BYTES      (WS2812_PIXELS * WS2812_MAX_CHANNELS)
+
+/* Pixels encoded per half of the DMA ring (one refill = one half) */
+#ifndef WS2812_RING_PIXELS
+#define WS2812_RING_PIXELS      2U
+#endif
+
+/* Ring sized for the widest format, narrower ones use a part of it */
+#define WS2812_HALF_SLOTS       (WS2812_RING_PIXELS * 8U * WS2812_MAX_CHANNELS)
+#define WS2812_RING_SLOTS       (2U * WS2812_HALF_SLOTS)
+
+/* Output engine */
+#define WS2812_OUTPUT_TIM17     0
+#define WS2812_OUTPUT_BSRR      1
+#define WS2812_OUTPUT_DMAR      2
+#define WS2812_OUTPUT_SPI       3
+
+#ifndef WS2812_OUTPUT
+#define WS2812_OUTPUT           WS2812_OUTPUT_TIM17
+#endif
+
+/* Parallel strips of the BSRR engine, on pins PIN0 .. PIN0 + STRIPS - 1 */
+#ifndef WS2812_BSRR_STRIPS
+#define WS2812_BSRR_STRIPS      8U
+#endif
+#ifndef WS2812_BSRR_PORT
+#define WS2812_BSRR_PORT        GPIOB
+#endif
+#ifndef WS2812_BSRR_PORT_CLK_ENABLE
+#define WS2812_BSRR_PORT_CLK_ENABLE() __HAL_RCC_GPIOB_CLK_ENABLE()
+#endif
+#ifndef WS2812_BSRR_PIN0
+#define WS2812_BSRR_PIN0        0U
+#endif
+
+/* SPI engine : bits per symbol, 1 = 110(0) and 0 = 100(0), and SPI1 clock
+   prescaler, 48 MHz / (2 << BR) : 3 MHz by default, i.e. 750 kHz on the
+   wire with 4-bit symbols or 1 MHz with 3-bit ones. The high times must
+   match WS2812_PROFILE, which the build checks (not the WS2811 profile) */
+#ifndef WS2812_SPI_SYMBOL_BITS
+#define WS2812_SPI_SYMBOL_BITS  4U
+#endif
+#ifndef WS2812_SPI_BR
+#define WS2812_SPI_BR           3U
+#endif
+
+/* Strips driven at once by the selected engine */
+#if (WS2812_OUTPUT == WS2812_OUTPUT_BSRR)
+#define WS2812_OUTPUTS          WS2812_BSRR_STRIPS
+#elif (WS2812_OUTPUT == WS2812_OUTPUT_DMAR)
+#define WS2812_OUTPUTS          4U
+#else
+#define WS2812_OUTPUTS          1U
+#endif
+
+/* Ring RAM of the selected engine : a byte per bit (TIM17), a halfword per
+   bit (BSRR), a compare byte per strip and bit (DMAR), a symbol per bit (SPI),
+   and DMA transfers per colour byte sent on every strip */
+#if (WS2812_OUTPUT == WS2812_OUTPUT_BSRR)
+#define WS2812_OUTPUT_RING_BYTES (2U * WS2812_RING_SLOTS)
+#define WS2812_OUTPUT_DMA_PER_BYTE 24U
+#elif (WS2812_OUTPUT == WS2812_OUTPUT_DMAR)
+#define WS2812_OUTPUT_RING_BYTES (4U * WS2812_RING_SLOTS)
+#define WS2812_OUTPUT_DMA_PER_BYTE 32U
+#elif (WS2812_OUTPUT == WS2812_OUTPUT_SPI)
+#define WS2812_OUTPUT_RING_BYTES (WS2812_RING_SLOTS * WS2812_SPI_SYMBOL_BITS / 8U)
+#define WS2812_OUTPUT_DMA_PER_BYTE WS2812_SPI_SYMBOL_BITS
+#else
+#define WS2812_OUTPUT_RING_BYTES WS2812_RING_SLOTS
+#define WS2812_OUTPUT_DMA_PER_BYTE 8U
+#endif
+
+/* Count the CPU cycles spent encoding, see WS2812_GetStats() */
+#ifndef WS2812_STATS
+#define WS2812_STATS            1
+#endif
+
+/* Exported types ------------------------------------------------------------*/
+/* Channel indexes in the frame buffer */
+#define WS2812_R                0U
+#define WS2812_G                1U
+#define WS2812_B                2U
+#define WS2812_W                3U
+
+/**
+  * @brief  Pixel format of a strip
+  */
+typedef struct
+{
+  uint8_t channels;   /* Bytes per pixel, 3 or 4 */
+  uint8_t order[4];   /* Frame buffer channel sent in each position, first first */
+} WS2812_FormatTypeDef;
+
+/**
+  * @brief  Encoder CPU load
+  */
+typedef struct
+{
+  uint32_t cycles;    /* CPU cycles spent refilling the ring */
+  uint32_t pixels;    /* Pixels encoded in that time */
+} WS2812_StatsTypeDef;
+
+/**
+  * @brief  Source of a streamed frame, see WS2812_PresentStream() : returns
+  *         the next bytes of the frame in frame buffer layout, in order. Called
+  *         from the output interrupt, a few pixels at a time.
+  */
+typedef const uint8_t *(*WS2812_FetchTypeDef)(uint32_t bytes);
+
+/* Exported variables --------------------------------------------------------*/
+extern const WS2812_FormatTypeDef WS2812_FormatGRB;
+extern const WS2812_FormatTypeDef WS2812_FormatRGB;
+extern const WS2812_FormatTypeDef WS2812_FormatBRG;
+extern const WS2812_FormatTypeDef WS2812_FormatGRBW;
+
+/* Gamma 2.8 curve for WS2812_SetGamma(), 16-bit output */
+extern const uint16_t WS2812_Gamma28[256];
+
+/* Exported functions prototypes ---------------------------------------------*/
+void WS2812_Init(void);
+HAL_StatusTypeDef WS2812_SetFormat(const WS2812_FormatTypeDef *format);
+const WS2812_FormatTypeDef *WS2812_GetFormat(void);
+void WS2812_SetGamma(const uint16_t *table);
+void WS2812_SetBrightness(uint8_t level);
+uint8_t WS2812_GetBrightness(void);
+void WS2812_SetDither(uint8_t enable);
+uint8_t WS2812_GetDither(void);
+HAL_StatusTypeDef WS2812_SetLength(uint16_t pixels);
+uint16_t WS2812_GetLength(void);
+void WS2812_SetPixel(uint16_t index, uint8_t red, uint8_t green, uint8_t blue);
+void WS2812_SetPixelRGBW(uint16_t index, uint8_t red, uint8_t green, uint8_t blue, uint8_t white);
+void WS2812_Fill(uint8_t red, uint8_t green, uint8_t blue);
+void WS2812_FillRGBW(uint8_t red, uint8_t green, uint8_t blue, uint8_t white);
+uint8_t *WS2812_GetBackBuffer(void);
+void WS2812_SyncBackBuffer(void);
+uint8_t WS2812_CanRender(void);
+HAL_StatusTypeDef WS2812_Present(uint32_t *fence);
+HAL_StatusTypeDef WS2812_PresentStream(uint16_t pixels, WS2812_FetchTypeDef fetch, uint32_t *fence);
+uint8_t WS2812_FenceReached(uint32_t fence);
+uint32_t WS2812_GetFramesDone(void);
+void WS2812_WaitFence(uint32_t fence);
+uint8_t WS2812_IsBusy(void);
+void WS2812_FrameDoneCallback(void);
+void WS2812_GetStats(WS2812_StatsTypeDef *stats, uint8_t reset);
+#if (WS2812_OUTPUT == WS2812_OUTPUT_BSRR)
+void WS2812_Bsrr_IRQHandler(void);
+#elif (WS2812_OUTPUT == WS2812_OUTPUT_DMAR)
+void WS2812_Dmar_IRQHandler(void);
+#elif (WS2812_OUTPUT == WS2812_OUTPUT_SPI)
+void WS2812_Spi_IRQHandler(void);
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __WS2812_H */
@@ -0,0 +1,101 @@
+/**
+  ******************************************************************************
+  * @file    ws2812_output.h
+  * @brief   Contract between the WS2812 frame side and the output engines.
+  ******************************************************************************
+  * ws2812.c owns the frame buffers, the level table, the fences and the
+  * frame queue. The engine selected by WS2812_OUTPUT turns one front buffer
+  * into bits on the wire, latches, then hands back with WS2812_Output_Done().
+  * Every engine applies the level table, the wire order and the dithering
+  * residue the same way, so frames look the same whichever one drives them.
+  * Only the selected engine is compiled, the others build to nothing.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __WS2812_OUTPUT_H
+#define __WS2812_OUTPUT_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "ws2812.h"
+
+/* Exported types ------------------------------------------------------------*/
+/**
+  * @brief  Frame handed to the engine, valid until WS2812_Output_Done()
+  */
+typedef struct
+{
+  const uint8_t *pixels;    /* Front buffer, R, G, B[, W] per pixel */
+  uint8_t *residue;         /* Dithering residue per byte of pixels */
+  const uint16_t *level;    /* 8.8 output level per channel value */
+  const uint8_t *order;     /* Frame buffer channel sent in each position */
+  uint16_t length;          /* Pixels in the frame */
+  uint8_t channels;         /* Bytes per pixel */
+  uint8_t dither;           /* Carry the level fraction through residue */
+  /* Cut-through source, NULL for a frame in pixels : returns the next bytes
+     of the frame, in order, up to WS2812_RING_PIXELS pixels at a time. Only
+     used without dithering, by the single-strip engines. */
+  WS2812_FetchTypeDef fetch;
+} WS2812_OutputFrameTypeDef;
+
+/* Exported functions prototypes ---------------------------------------------*/
+/* Implemented by the engine */
+void WS2812_Output_Init(void);
+HAL_StatusTypeDef WS2812_Output_Start(const WS2812_OutputFrameTypeDef *frame);
+
+/* Implemented by ws2812.c, called by the engine from its interrupts */
+void WS2812_Output_Done(void);
+void WS2812_Output_Account(uint32_t cycles, uint32_t pixels);
+
+/**
+  * @brief  Output byte of one channel value : level, plus the residue of the
+  *         previous frame when dithering, whose new fraction is stored back.
+  * @param  frame: frame being sent
+  * @param  index: byte index in the frame buffer
+  * @retval Byte to send
+  */
+static inline uint8_t WS2812_Output_Level(const WS2812_OutputFrameTypeDef *frame, uint32_t index)
+{
+  uint32_t value = frame->level[frame->pixels[index]];
+
+  if (frame->dither)
+  {
+    value += frame->residue[index];
+    frame->residue[index] = (uint8_t)value;
+  }
+  return (uint8_t)(value >> 8);
+}
+
+/**
+  * @brief  Pixels of the chain among the positions a parallel engine just
+  *         encoded, leaving out the black padding past the end of the chain.
+  * @param  frame: frame being sent
+  * @param  stripPixels: pixels per strip, the chain split evenly
+  * @param  strips: strips driven
+  * @param  first: first position encoded on each strip
+  * @param  count: positions encoded on each strip
+  * @retval Chain pixels encoded
+  */
+static inline uint32_t WS2812_Output_Pixels(const WS2812_OutputFrameTypeDef *frame, uint32_t stripPixels,
+                                            uint32_t strips, uint32_t first, uint32_t count)
+{
+  uint32_t pixels = 0U;
+
+  for (uint32_t chain = first; (chain < frame->length) && (strips != 0U); chain += stripPixels, strips--)
+  {
+    uint32_t left = frame->length - chain;
+
+    pixels += (left < count) ? left : count;
+  }
+  return pixels;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __WS2812_OUTPUT_H */
@@ -0,0 +1,84 @@
+/**
+  ******************************************************************************
+  * @file    ws2812_profiles.h
+  * @brief   Bit timing of the supported LED chips.
+  ******************************************************************************
+  * Select one with WS2812_PROFILE (default WS2812B). Each profile gives the
+  * bit period, the high time of a 0 and of a 1 bit, all in ns, and the reset
+  * latch in us. They are turned into TIM17 ticks here, at compile time, and
+  * checked against the timer clock so the encoder never does timing math.
+  *
+  * TM1814 : timing only. The chip idles high with inverted bit polarity and
+  * expects its constant-current setting words ahead of the pixel data of
+  * every frame ; neither is generated here. Driving one takes an inverting
+  * buffer on the data line, the GRBW format, and the application writing
+  * the setting word and its complement as the first two pixels of every
+  * frame (in frame buffer order, with linear gamma and full brightness so
+  * that the levels leave them intact).
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __WS2812_PROFILES_H
+#define __WS2812_PROFILES_H
+
+/* Exported constants --------------------------------------------------------*/
+#define WS2812_PROFILE_WS2812B  0
+#define WS2812_PROFILE_WS2811   1   /* 400 kHz mode */
+#define WS2812_PROFILE_SK6812   2
+#define WS2812_PROFILE_WS2813   3
+#define WS2812_PROFILE_TM1814   4   /* Timing only, see above */
+
+#ifndef WS2812_PROFILE
+#define WS2812_PROFILE          WS2812_PROFILE_WS2812B
+#endif
+
+/* TIM17 kernel clock, as set by SystemClock_Config() */
+#define WS2812_TIMER_MHZ        48U
+
+#if (WS2812_PROFILE == WS2812_PROFILE_WS2812B)
+#define WS2812_BIT_NS           1250U
+#define WS2812_T0H_NS           400U
+#define WS2812_T1H_NS           800U
+#define WS2812_PROFILE_LATCH_US 280U
+#elif (WS2812_PROFILE == WS2812_PROFILE_WS2811)
+#define WS2812_BIT_NS           2500U
+#define WS2812_T0H_NS           500U
+#define WS2812_T1H_NS           1200U
+#define WS2812_PROFILE_LATCH_US 50U
+#elif (WS2812_PROFILE == WS2812_PROFILE_SK6812)
+#define WS2812_BIT_NS           1250U
+#define WS2812_T0H_NS           300U
+#define WS2812_T1H_NS           600U
+#define WS2812_PROFILE_LATCH_US 80U
+#elif (WS2812_PROFILE == WS2812_PROFILE_WS2813)
+#define WS2812_BIT_NS           1250U
+#define WS2812_T0H_NS           300U
+#define WS2812_T1H_NS           750U
+#define WS2812_PROFILE_LATCH_US 300U
+#elif (WS2812_PROFILE == WS2812_PROFILE_TM1814)
+#define WS2812_BIT_NS           1250U
+#define WS2812_T0H_NS           360U
+#define WS2812_T1H_NS           720U
+#define WS2812_PROFILE_LATCH_US 200U
+#else
+#error "Unknown WS2812_PROFILE"
+#endif
+
+/* Low time after the last bit for the strip to latch the frame */
+#ifndef WS2812_LATCH_US
+#define WS2812_LATCH_US         WS2812_PROFILE_LATCH_US
+#endif
+
+/* Timings in output timer ticks, rounded to the nearest tick */
+#define WS2812_NS_TO_TICKS(ns)  (((ns) * WS2812_TIMER_MHZ + 500U) / 1000U)
+#define WS2812_BIT_TICKS        WS2812_NS_TO_TICKS(WS2812_BIT_NS)
+#define WS2812_T0H_TICKS        WS2812_NS_TO_TICKS(WS2812_T0H_NS)
+#define WS2812_T1H_TICKS        WS2812_NS_TO_TICKS(WS2812_T1H_NS)
+
+#if (WS2812_T0H_TICKS == 0U) || (WS2812_T0H_TICKS >= WS2812_T1H_TICKS) || \
+    (WS2812_T1H_TICKS >= WS2812_BIT_TICKS)
+#error "Profile timings cannot be told apart at this timer clock"
+#endif
+
+#endif /* __WS2812_PROFILES_H */
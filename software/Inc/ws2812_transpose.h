@@ -0,0 +1,70 @@
+/**
+  ******************************************************************************
+  * @file    ws2812_transpose.h
+  * @brief   8 x 8 bit transpose for the parallel output engines.
+  ******************************************************************************
+  * A parallel engine sends bit 7 of every strip, then bit 6, and so on : the
+  * output byte of each strip has to be turned into one port word per bit
+  * position. Testing bits one at a time costs 8 x 8 shifts, tests and ORs per
+  * group of 8 strips. The kernel below swaps 2 x 2, then 4 x 4 blocks of the
+  * 8 x 8 bit matrix held in two registers (Hacker's Delight, 7-3), i.e. about
+  * 30 Thumb-1 data instructions for 64 bits, all of them single-cycle shifts,
+  * ANDs and EORs ; the three masks are the only literal pool loads.
+  *
+  * Layout : the 8 strip bytes are read as two little-endian words, strip s
+  * in byte s. Once transposed, byte 3 - k of x (k = 0..3) and of y (k = 4..7)
+  * holds bit 7 - k of every strip, strip s in bit s : the port word of the
+  * k-th bit on the wire, MSB first.
+  *
+  * host/transpose.py holds the bit-by-bit reference and checks this kernel
+  * against it. More strips are handled 8 at a time, one transpose per group.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __WS2812_TRANSPOSE_H
+#define __WS2812_TRANSPOSE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+
+/* Exported functions --------------------------------------------------------*/
+/**
+  * @brief  Transpose the 8 x 8 bit matrix of 8 strip bytes in place.
+  * @param  x: in, strips 4..7 (word 1 of the bytes) ; out, bits 7..4
+  * @param  y: in, strips 0..3 (word 0 of the bytes) ; out, bits 3..0
+  * @retval None
+  */
+static inline void WS2812_Transpose8x8(uint32_t *x, uint32_t *y)
+{
+  uint32_t a = *x;
+  uint32_t b = *y;
+  uint32_t t;
+
+  /* 2 x 2 blocks, within each half */
+  t = (a ^ (a >> 7)) & 0x00AA00AAUL;
+  a = a ^ t ^ (t << 7);
+  t = (b ^ (b >> 7)) & 0x00AA00AAUL;
+  b = b ^ t ^ (t << 7);
+
+  /* 4 x 4 blocks, within each half */
+  t = (a ^ (a >> 14)) & 0x0000CCCCUL;
+  a = a ^ t ^ (t << 14);
+  t = (b ^ (b >> 14)) & 0x0000CCCCUL;
+  b = b ^ t ^ (t << 14);
+
+  /* Swap the off-diagonal 4 x 4 blocks across the halves */
+  t = (a & 0xF0F0F0F0UL) | ((b >> 4) & 0x0F0F0F0FUL);
+  *y = ((a << 4) & 0xF0F0F0F0UL) | (b & 0x0F0F0F0FUL);
+  *x = t;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __WS2812_TRANSPOSE_H */
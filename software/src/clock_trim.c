@@ -0,0 +1,196 @@
+/**
+  ******************************************************************************
+  * @file    clock_trim.c
+  * @brief   HSI48 trimming on USB SOF (CRS) and clock error telemetry.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "clock_trim.h"
+
+/* Private define ------------------------------------------------------------*/
+/* Lowest priority : the CRS trims on its own, the interrupt only counts */
+#define CLOCK_TRIM_IRQ_PRIORITY 3U
+
+/* Private variables ---------------------------------------------------------*/
+static ClockTrim_StatsTypeDef stats;
+
+/* SYSCLK error window, opened on a SOF stamp */
+static uint8_t windowOpen;
+static uint32_t windowCount;
+static uint32_t windowTick;
+static uint32_t windowPhase;
+static uint32_t lastCount;
+
+/* Private function prototypes -----------------------------------------------*/
+static void ClockTrim_Capture(void);
+
+/* Private user code ---------------------------------------------------------*/
+
+/**
+  * @brief  Lock HSI48 to USB SOF and, with CLOCK_TRIM_SYSCLK_HSI48, move
+  *         SYSCLK to it. To be called right after SystemClock_Config(), the
+  *         frequency does not change so running peripherals are not upset.
+  * @retval None
+  */
+void ClockTrim_Init(void)
+{
+  RCC_CRSInitTypeDef crs = {0};
+
+  __HAL_RCC_CRS_CLK_ENABLE();
+
+  crs.Prescaler = RCC_CRS_SYNC_DIV1;
+  crs.Source = RCC_CRS_SYNC_SOURCE_USB;
+  crs.Polarity = RCC_CRS_SYNC_POLARITY_RISING;
+  crs.ReloadValue = __HAL_RCC_CRS_RELOADVALUE_CALCULATE(HSI48_VALUE, 1000U);
+  crs.ErrorLimitValue = RCC_CRS_ERRORLIMIT_DEFAULT;
+  crs.HSI48CalibrationValue = RCC_CRS_HSI48CALIBRATION_DEFAULT;
+  HAL_RCCEx_CRSConfig(&crs);
+
+  __HAL_RCC_CRS_ENABLE_IT(RCC_CRS_IT_SYNCOK | RCC_CRS_IT_SYNCWARN | RCC_CRS_IT_ERR);
+  HAL_NVIC_SetPriority(RCC_CRS_IRQn, CLOCK_TRIM_IRQ_PRIORITY, 0);
+  HAL_NVIC_EnableIRQ(RCC_CRS_IRQn);
+
+#if (CLOCK_TRIM_SYSCLK_HSI48 != 0)
+  RCC_ClkInitTypeDef clk = {0};
+  RCC_OscInitTypeDef osc = {0};
+
+  clk.ClockType = RCC_CLOCKTYPE_SYSCLK;
+  clk.SYSCLKSource = RCC_SYSCLKSOURCE_HSI48;
+  if (HAL_RCC_ClockConfig(&clk, FLASH_LATENCY_1) != HAL_OK)
+  {
+    Error_Handler();
+  }
+
+  /* Nothing else runs on the PLL */
+  osc.OscillatorType = RCC_OSCILLATORTYPE_NONE;
+  osc.PLL.PLLState = RCC_PLL_OFF;
+  if (HAL_RCC_OscConfig(&osc) != HAL_OK)
+  {
+    Error_Handler();
+  }
+#endif
+
+  stats.sysclkHsi48 = (__HAL_RCC_GET_SYSCLK_SOURCE() == RCC_SYSCLKSOURCE_STATUS_HSI48) ? 1U : 0U;
+  stats.trim = RCC_CRS_HSI48CALIBRATION_DEFAULT;
+}
+
+/**
+  * @brief  Measure SYSCLK against SOF. Called with the SOF stamps, which are
+  *         taken at a fixed point of the USB interrupt : over a window of
+  *         CLOCK_TRIM_WINDOW SOFs the latency jitter is well below 1 ppm.
+  * @param  count: SOFs since reset
+  * @param  tick: HAL tick at that SOF
+  * @param  phase: SYSCLK cycles into that tick
+  * @retval None
+  */
+void ClockTrim_Sof(uint32_t count, uint32_t tick, uint32_t phase)
+{
+  /* A missed SOF or a bus reset restarts the window */
+  if ((windowOpen == 0U) || (count != lastCount + 1U))
+  {
+    windowOpen = 1U;
+    windowCount = count;
+    windowTick = tick;
+    windowPhase = phase;
+    lastCount = count;
+    return;
+  }
+  lastCount = count;
+
+  uint32_t sofs = count - windowCount;
+
+  if (sofs < CLOCK_TRIM_WINDOW)
+  {
+    return;
+  }
+
+  /* Cycles counted against cycles expected for that many host milliseconds */
+  uint32_t period = SysTick->LOAD + 1U;
+  int32_t elapsed = (int32_t)(((tick - windowTick) * period) + phase - windowPhase);
+  int32_t expected = (int32_t)(sofs * period);
+
+  stats.sysclkPpm = (int32_t)(((int64_t)(elapsed - expected) * 1000000) / expected);
+
+  windowCount = count;
+  windowTick = tick;
+  windowPhase = phase;
+}
+
+/**
+  * @brief  Read the clock telemetry.
+  * @param  out: receives the counters
+  * @param  reset: clear the counters and the error peak after reading
+  * @retval None
+  */
+void ClockTrim_GetStats(ClockTrim_StatsTypeDef *out, uint8_t reset)
+{
+  uint32_t primask = __get_PRIMASK();
+
+  __disable_irq();
+  *out = stats;
+  if (reset)
+  {
+    stats.syncOk = 0U;
+    stats.syncWarn = 0U;
+    stats.syncErr = 0U;
+    stats.hsi48ErrorMax = 0U;
+  }
+  __set_PRIMASK(primask);
+}
+
+/**
+  * @brief  Record the HSI48 error latched at the last SYNC and the trim.
+  * @retval None
+  */
+static void ClockTrim_Capture(void)
+{
+  RCC_CRSSynchroInfoTypeDef info;
+
+  HAL_RCCEx_CRSGetSynchronizationInfo(&info);
+
+  /* Up-counting means HSI48 reached the reload value early : it is fast */
+  int16_t error = (int16_t)info.FreqErrorCapture;
+  if (info.FreqErrorDirection == RCC_CRS_FREQERRORDIR_DOWN)
+  {
+    error = (int16_t)-error;
+  }
+  uint16_t magnitude = (uint16_t)info.FreqErrorCapture;
+
+  stats.hsi48Error = error;
+  if (magnitude > stats.hsi48ErrorMax)
+  {
+    stats.hsi48ErrorMax = magnitude;
+  }
+  stats.trim = (uint8_t)info.HSI48CalibrationValue;
+}
+
+/**
+  * @brief  HSI48 within the error limit at this SOF.
+  * @retval None
+  */
+void HAL_RCCEx_CRS_SyncOkCallback(void)
+{
+  stats.syncOk++;
+  ClockTrim_Capture();
+}
+
+/**
+  * @brief  HSI48 beyond the error limit at this SOF, the CRS trims harder.
+  * @retval None
+  */
+void HAL_RCCEx_CRS_SyncWarnCallback(void)
+{
+  stats.syncWarn++;
+  ClockTrim_Capture();
+}
+
+/**
+  * @brief  SYNC too far off or missing (no SOF), or trim at its end stop.
+  * @param  Error: RCC_CRS_SYNCERR, RCC_CRS_SYNCMISS and/or RCC_CRS_TRIMOVF
+  * @retval None
+  */
+void HAL_RCCEx_CRS_ErrorCallback(uint32_t Error)
+{
+  stats.syncErr++;
+}
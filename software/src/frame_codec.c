@@ -0,0 +1,401 @@
+/**
+  ******************************************************************************
+  * @file    frame_codec.c
+  * @brief   Streaming decoder for compressed pixel frames.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "frame_codec.h"
+#include "ws2812.h"
+#include <string.h>
+
+/* Private typedef -----------------------------------------------------------*/
+typedef enum
+{
+  CODEC_HEADER = 0,
+  CODEC_RAW,
+  CODEC_OP,
+  CODEC_LITERAL,
+  CODEC_RUN,
+  CODEC_PALETTE_COUNT,
+  CODEC_PALETTE,
+  CODEC_INDEXES,
+  CODEC_END
+} FrameCodec_StateTypeDef;
+
+/* Private variables ---------------------------------------------------------*/
+static FrameCodec_StateTypeDef state;
+static FrameCodec_StatusTypeDef result;
+static uint8_t header[FRAME_CODEC_HEADER_LEN];
+static uint8_t headerLen;
+static uint8_t encoding;
+static uint32_t payloadLeft;
+
+/* Destination */
+static uint8_t *frame;
+static uint32_t frameBytes;
+static uint32_t framePos;
+static uint8_t channels;
+
+/* Current op : bytes of a literal or of the palette, pixels of a run */
+static uint32_t opLeft;
+static uint8_t pixel[4];
+static uint8_t pixelLen;
+
+/* Palette, kept from frame to frame */
+static uint8_t palette[FRAME_CODEC_PALETTE_SIZE * WS2812_MAX_CHANNELS];
+static uint16_t paletteEntries;
+static uint16_t paletteIncoming;   /* Entries of the palette being received */
+static uint8_t paletteChannels;
+static uint32_t palettePos;
+
+/* Private function prototypes -----------------------------------------------*/
+static void FrameCodec_Start(void);
+static void FrameCodec_End(void);
+static void FrameCodec_Write(const uint8_t *src, uint32_t len);
+static void FrameCodec_Run(uint32_t count);
+static void FrameCodec_Lookup(const uint8_t *src, uint32_t len);
+
+/* Private user code ---------------------------------------------------------*/
+
+/**
+  * @brief  Start decoding a frame.
+  * @param  dst: the strip's back buffer, a DELTA frame syncs it first
+  * @param  pixels: pixels on the strip
+  * @param  pixelChannels: bytes per pixel
+  * @retval None
+  */
+void FrameCodec_Begin(uint8_t *dst, uint16_t pixels, uint8_t pixelChannels)
+{
+  frame = dst;
+  channels = pixelChannels;
+  frameBytes = (uint32_t)pixels * pixelChannels;
+  framePos = 0U;
+  headerLen = 0U;
+  state = CODEC_HEADER;
+  result = FRAME_CODEC_BUSY;
+
+  /* Palette entries are stored in the strip's layout */
+  if (paletteChannels != channels)
+  {
+    paletteEntries = 0U;
+  }
+}
+
+/**
+  * @brief  The header is in : set the frame base and the first state.
+  * @retval None
+  */
+static void FrameCodec_Start(void)
+{
+  encoding = header[0];
+  payloadLeft = header[2] | ((uint32_t)header[3] << 8);
+
+  /* Reserved byte : room for later header versions */
+  if (header[1] != 0U)
+  {
+    state = CODEC_END;
+    result = FRAME_CODEC_ERROR;
+    return;
+  }
+
+  switch (encoding)
+  {
+    case FRAME_CODEC_RAW:
+      state = CODEC_RAW;
+      break;
+
+    case FRAME_CODEC_RLE:
+      memset(frame, 0, frameBytes);
+      state = CODEC_OP;
+      break;
+
+    case FRAME_CODEC_DELTA:
+      WS2812_SyncBackBuffer();
+      state = CODEC_OP;
+      break;
+
+    case FRAME_CODEC_PALETTE:
+      memset(frame, 0, frameBytes);
+      pixelLen = 0U;
+      state = CODEC_PALETTE_COUNT;
+      break;
+
+    default:
+      state = CODEC_END;
+      result = FRAME_CODEC_ERROR;
+      return;
+  }
+
+  if (payloadLeft == 0U)
+  {
+    FrameCodec_End();
+  }
+}
+
+/**
+  * @brief  The payload is over : complete if it ended between two ops.
+  * @retval None
+  */
+static void FrameCodec_End(void)
+{
+  switch (state)
+  {
+    case CODEC_RAW:
+      /* A short frame turns the rest of the strip off */
+      if (framePos < frameBytes)
+      {
+        memset(&frame[framePos], 0, frameBytes - framePos);
+      }
+      result = FRAME_CODEC_DONE;
+      break;
+
+    case CODEC_OP:
+    case CODEC_INDEXES:
+      result = FRAME_CODEC_DONE;
+      break;
+
+    default:
+      result = FRAME_CODEC_ERROR;
+      break;
+  }
+  state = CODEC_END;
+}
+
+/**
+  * @brief  Store pixel bytes, the part past the end of the strip is dropped.
+  * @param  src: pixel bytes
+  * @param  len: number of bytes
+  * @retval None
+  */
+static void FrameCodec_Write(const uint8_t *src, uint32_t len)
+{
+  if (framePos < frameBytes)
+  {
+    uint32_t n = frameBytes - framePos;
+    memcpy(&frame[framePos], src, (len < n) ? len : n);
+  }
+  framePos += len;
+}
+
+/**
+  * @brief  Repeat the pixel just received.
+  * @param  count: number of pixels
+  * @retval None
+  */
+static void FrameCodec_Run(uint32_t count)
+{
+  uint8_t *dst = &frame[framePos];
+  uint32_t room = (framePos < frameBytes) ? (frameBytes - framePos) / channels : 0U;
+
+  framePos += count * channels;
+  if (count > room)
+  {
+    count = room;
+  }
+
+  if (channels == 4U)
+  {
+    while (count--)
+    {
+      dst[0] = pixel[0];
+      dst[1] = pixel[1];
+      dst[2] = pixel[2];
+      dst[3] = pixel[3];
+      dst += 4;
+    }
+  }
+  else
+  {
+    while (count--)
+    {
+      dst[0] = pixel[0];
+      dst[1] = pixel[1];
+      dst[2] = pixel[2];
+      dst += 3;
+    }
+  }
+}
+
+/**
+  * @brief  Expand palette indexes, an index past the palette is black.
+  * @param  src: indexes
+  * @param  len: number of indexes
+  * @retval None
+  */
+static void FrameCodec_Lookup(const uint8_t *src, uint32_t len)
+{
+  uint32_t room = (framePos < frameBytes) ? (frameBytes - framePos) / channels : 0U;
+  uint8_t *dst = &frame[framePos];
+
+  framePos += len * channels;
+  if (len > room)
+  {
+    len = room;
+  }
+
+  while (len--)
+  {
+    uint32_t index = *src++;
+
+    if (index < paletteEntries)
+    {
+      const uint8_t *entry = &palette[index * channels];
+
+      dst[0] = entry[0];
+      dst[1] = entry[1];
+      dst[2] = entry[2];
+      if (channels == 4U)
+      {
+        dst[3] = entry[3];
+      }
+    }
+    dst += channels;
+  }
+}
+
+/**
+  * @brief  Decode received bytes.
+  * @param  data: bytes received
+  * @param  len: number of bytes
+  * @retval FRAME_CODEC_BUSY until the frame is complete or broken
+  */
+FrameCodec_StatusTypeDef FrameCodec_Feed(const uint8_t *data, uint16_t len)
+{
+  uint32_t i = 0U;
+
+  while ((i < len) && (state != CODEC_END))
+  {
+    if (state == CODEC_HEADER)
+    {
+      header[headerLen++] = data[i++];
+      if (headerLen == FRAME_CODEC_HEADER_LEN)
+      {
+        FrameCodec_Start();
+      }
+      continue;
+    }
+
+    const uint8_t *src = &data[i];
+    uint32_t avail = len - i;
+    uint32_t used = 1U;
+
+    if (avail > payloadLeft)
+    {
+      avail = payloadLeft;
+    }
+
+    switch (state)
+    {
+      case CODEC_RAW:
+        used = avail;
+        FrameCodec_Write(src, used);
+        break;
+
+      case CODEC_OP:
+        if (*src < FRAME_CODEC_OP_RUN)
+        {
+          opLeft = ((uint32_t)*src + 1U) * channels;
+          state = CODEC_LITERAL;
+        }
+        else if (*src < FRAME_CODEC_OP_SKIP)
+        {
+          opLeft = (*src & 0x3FU) + 1U;
+          pixelLen = 0U;
+          state = CODEC_RUN;
+        }
+        else
+        {
+          framePos += ((*src & 0x3FU) + 1U) * channels;
+        }
+        break;
+
+      case CODEC_LITERAL:
+        used = (avail < opLeft) ? avail : opLeft;
+        FrameCodec_Write(src, used);
+        opLeft -= used;
+        if (opLeft == 0U)
+        {
+          state = CODEC_OP;
+        }
+        break;
+
+      case CODEC_RUN:
+        pixel[pixelLen++] = *src;
+        if (pixelLen == channels)
+        {
+          FrameCodec_Run(opLeft);
+          state = CODEC_OP;
+        }
+        break;
+
+      case CODEC_PALETTE_COUNT:
+        pixel[pixelLen++] = *src;
+        if (pixelLen == 2U)
+        {
+          uint32_t entries = pixel[0] | ((uint32_t)pixel[1] << 8);
+
+          if (entries > FRAME_CODEC_PALETTE_SIZE)
+          {
+            state = CODEC_END;
+            result = FRAME_CODEC_ERROR;
+            return result;
+          }
+          if (entries != 0U)
+          {
+            /* The old palette is overwritten : no palette until the new
+               one is whole, so a truncated one is never reused */
+            paletteEntries = 0U;
+            paletteIncoming = (uint16_t)entries;
+            palettePos = 0U;
+            opLeft = entries * channels;
+            state = CODEC_PALETTE;
+          }
+          else if (paletteEntries != 0U)
+          {
+            state = CODEC_INDEXES;
+          }
+          else
+          {
+            state = CODEC_END;
+            result = FRAME_CODEC_ERROR;
+            return result;
+          }
+        }
+        break;
+
+      case CODEC_PALETTE:
+        used = (avail < opLeft) ? avail : opLeft;
+        memcpy(&palette[palettePos], src, used);
+        palettePos += used;
+        opLeft -= used;
+        if (opLeft == 0U)
+        {
+          paletteEntries = paletteIncoming;
+          paletteChannels = channels;
+          state = CODEC_INDEXES;
+        }
+        break;
+
+      case CODEC_INDEXES:
+        used = avail;
+        FrameCodec_Lookup(src, used);
+        break;
+
+      default:
+        state = CODEC_END;
+        result = FRAME_CODEC_ERROR;
+        return result;
+    }
+
+    i += used;
+    payloadLeft -= used;
+    if (payloadLeft == 0U)
+    {
+      FrameCodec_End();
+    }
+  }
+
+  return result;
+}
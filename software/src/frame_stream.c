@@ -0,0 +1,213 @@
+/**
+  ******************************************************************************
+  * @file    frame_stream.c
+  * @brief   Elastic buffer between the bulk endpoint and a streamed frame.
+  ******************************************************************************
+  * Single producer, single consumer : FrameStream_Push() runs in the USB
+  * interrupt, FrameStream_Fetch() in the output interrupt, which preempts
+  * it. head and tail count bytes since FrameStream_Begin() and are each
+  * written by one side only, so the FIFO needs no lock.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "frame_stream.h"
+#include "ws2812.h"
+#include <string.h>
+
+/* Private define ------------------------------------------------------------*/
+#define FRAME_STREAM_MASK       (FRAME_STREAM_BYTES - 1U)
+
+/* Private variables ---------------------------------------------------------*/
+static uint8_t fifo[FRAME_STREAM_BYTES];
+static volatile uint32_t head;      /* Bytes pushed */
+static volatile uint32_t tail;      /* Bytes fetched */
+static uint32_t expected;           /* Bytes of the frame still to push */
+static volatile uint8_t ended;      /* Every byte of the frame is pushed */
+static volatile uint8_t broken;     /* Underrun : the rest goes out black */
+
+/* The USB side waits for this much room */
+static volatile uint8_t waiting;
+static volatile uint32_t wanted;
+
+/* Bytes handed to the engine, at most one refill */
+static uint8_t staging[WS2812_RING_PIXELS * WS2812_MAX_CHANNELS];
+
+static FrameStream_StatsTypeDef stats = { 0U, FRAME_STREAM_BYTES };
+
+/* Private user code ---------------------------------------------------------*/
+
+/**
+  * @brief  Start a new frame, once the previous one is off the wire.
+  * @param  bytes: frame length, pixels x channels
+  * @retval None
+  */
+void FrameStream_Begin(uint32_t bytes)
+{
+  head = 0U;
+  tail = 0U;
+  expected = bytes;
+  broken = 0U;
+  waiting = 0U;
+  ended = (bytes == 0U);
+}
+
+/**
+  * @brief  Tell whether a packet can be pushed. If not, FrameStream_RoomCallback()
+  *         is called once the wire has made room for it.
+  * @param  bytes: packet length
+  * @retval 1 if there is room
+  */
+uint8_t FrameStream_Reserve(uint32_t bytes)
+{
+  /* Flag first : a fetch freeing room right after the test calls back */
+  wanted = bytes;
+  waiting = 1U;
+
+  if (broken || (FRAME_STREAM_BYTES - (head - tail) >= bytes))
+  {
+    waiting = 0U;
+    return 1U;
+  }
+  return 0U;
+}
+
+/**
+  * @brief  Add received bytes to the frame. Bytes past its end are dropped,
+  *         and so is the rest of a frame that underran.
+  * @param  data: bytes
+  * @param  len: byte count, room checked by FrameStream_Reserve()
+  * @param  last: the transfer ended, the frame is cut short
+  * @retval 1 once the frame is complete
+  */
+uint8_t FrameStream_Push(const uint8_t *data, uint32_t len, uint8_t last)
+{
+  uint32_t primask;
+
+  if (len > expected)
+  {
+    len = expected;
+  }
+  expected -= len;
+
+  if (!broken && (len != 0U))
+  {
+    uint32_t pos = head & FRAME_STREAM_MASK;
+    uint32_t first = FRAME_STREAM_BYTES - pos;
+
+    if (first > len)
+    {
+      first = len;
+    }
+    memcpy(&fifo[pos], data, first);
+    memcpy(fifo, data + first, len - first);
+  }
+
+  /* The wire must not see the frame end without its last bytes */
+  primask = __get_PRIMASK();
+  __disable_irq();
+  if (!broken)
+  {
+    head += len;
+  }
+  if (last || (expected == 0U))
+  {
+    ended = 1U;
+  }
+  __set_PRIMASK(primask);
+
+  return ended;
+}
+
+/**
+  * @brief  Bytes received ahead of the wire.
+  * @retval FIFO level
+  */
+uint32_t FrameStream_Level(void)
+{
+  return head - tail;
+}
+
+/**
+  * @brief  Next bytes of the frame for the output engine, WS2812_FetchTypeDef.
+  *         Black past a short frame, and after an underrun.
+  * @param  bytes: byte count, at most WS2812_RING_PIXELS pixels
+  * @retval Bytes, valid until the next call
+  */
+const uint8_t *FrameStream_Fetch(uint32_t bytes)
+{
+  uint32_t level = head - tail;
+  uint32_t take = 0U;
+
+  if (bytes > sizeof(staging))
+  {
+    bytes = sizeof(staging);
+  }
+
+  if (!ended && !broken)
+  {
+    if (level < stats.minLevel)
+    {
+      stats.minLevel = level;
+    }
+    if (level < bytes)
+    {
+      broken = 1U;
+      stats.underruns++;
+    }
+  }
+
+  if (!broken)
+  {
+    uint32_t pos = tail & FRAME_STREAM_MASK;
+    uint32_t first;
+
+    take = (level < bytes) ? level : bytes;
+    first = FRAME_STREAM_BYTES - pos;
+    if (first > take)
+    {
+      first = take;
+    }
+    memcpy(staging, &fifo[pos], first);
+    memcpy(&staging[first], fifo, take - first);
+    tail += take;
+  }
+  memset(&staging[take], 0, bytes - take);
+
+  if (waiting && (broken || (FRAME_STREAM_BYTES - (head - tail) >= wanted)))
+  {
+    waiting = 0U;
+    FrameStream_RoomCallback();
+  }
+
+  return staging;
+}
+
+/**
+  * @brief  Read the stream counters.
+  * @param  out: receives the counters
+  * @param  reset: clear the counters after reading
+  * @retval None
+  */
+void FrameStream_GetStats(FrameStream_StatsTypeDef *out, uint8_t reset)
+{
+  uint32_t primask = __get_PRIMASK();
+
+  __disable_irq();
+  *out = stats;
+  if (reset)
+  {
+    stats.underruns = 0U;
+    stats.minLevel = FRAME_STREAM_BYTES;
+  }
+  __set_PRIMASK(primask);
+}
+
+/**
+  * @brief  The wire made the room asked for by FrameStream_Reserve().
+  * @note   Called from the output engine interrupt, to be overridden by the user.
+  * @retval None
+  */
+__weak void FrameStream_RoomCallback(void)
+{
+}
@@ -22,7 +22,9 @@
 /* Private includes ----------------------------------------------------------*/
 /* USER CODE BEGIN Includes */
 #include "stm32f0xx_hal_tim.h"
-#include <string.h>
+#include "ws2812.h"
+#include "usb_core.h"
+#include "clock_trim.h"
 /* USER CODE END Includes */
 
 /* Private typedef -----------------------------------------------------------*/
@@ -64,31 +66,14 @@ static void MX_USB_PCD_Init(void);
 /* USER CODE BEGIN 0 */
 
 
-
-// void HAL_TIM_PWM_PulseFinishedCallback(TIM_HandleTypeDef *htim){
-//   HAL_TIM_PWM_Stop_DMA(htim, TIM_CHANNEL_1); 
-// }
-
-uint16_t pwmData[24+100];
-
 void sendColor(uint8_t red, uint8_t green, uint8_t blue)
 {
-
-  uint32_t color = ((uint32_t)green << 16) | ((uint32_t)red << 8) | blue; // GRB, MSB en premier
-
-  for (int i = 0; i < 24; i++)
+  while (!WS2812_CanRender())
   {
-    if (color & (1 << (23 - i))){
-      pwmData[i] = 2/3.0 * LED_CNT; // bit 1
-    }
-    else
-    {
-      pwmData[i] = 1/3.0 * LED_CNT; // bit 0
-    }
   }
 
-  HAL_TIM_PWM_Start_DMA(&htim17, TIM_CHANNEL_1, (uint32_t*)pwmData, sizeof(pwmData) / sizeof(pwmData[0]));
-  
+  WS2812_Fill(red, green, blue);
+  WS2812_Present(NULL);
 }
 
 /* USER CODE END 0 */
@@ -117,6 +102,7 @@ int main(void)
   SystemClock_Config();
 
   /* USER CODE BEGIN SysInit */
+  ClockTrim_Init();
 
   /* USER CODE END SysInit */
 
@@ -126,10 +112,12 @@ int main(void)
   MX_TIM17_Init();
   MX_USB_PCD_Init();
   /* USER CODE BEGIN 2 */
+  WS2812_Init();
 
-  memset(pwmData, 0, sizeof(pwmData));
   sendColor(0,0,255);
 
+  USB_Core_Init();
+
 
   
   /* USER CODE END 2 */
@@ -138,7 +126,8 @@ int main(void)
   /* USER CODE BEGIN WHILE */
   while (1)
   {
-    for(int red = 0; red < 256; red++){
+    /* Demo ramp until a host takes over the strip */
+    for(int red = 0; red < 256 && !USB_Core_IsConfigured(); red++){
       sendColor(red, 0, 0);
       HAL_Delay(2000/256);
     }
@@ -220,7 +209,7 @@ static void MX_TIM17_Init(void)
   htim17.Instance = TIM17;
   htim17.Init.Prescaler = 0;
   htim17.Init.CounterMode = TIM_COUNTERMODE_UP;
-  htim17.Init.Period = LED_CNT -1 ;
+  htim17.Init.Period = BIT_PERIOD -1 ;
   htim17.Init.ClockDivision = TIM_CLOCKDIVISION_DIV1;
   htim17.Init.RepetitionCounter = 0;
   htim17.Init.AutoReloadPreload = TIM_AUTORELOAD_PRELOAD_DISABLE;
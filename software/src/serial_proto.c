@@ -0,0 +1,302 @@
+/**
+  ******************************************************************************
+  * @file    serial_proto.c
+  * @brief   Streaming parser for the Adalight and tpm2 serial framings.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "serial_proto.h"
+#include "usb_frame.h"
+#include "ws2812.h"
+#include <string.h>
+
+/* Private define ------------------------------------------------------------*/
+#define ADA_HEADER_LEN          6U
+#define ADA_CHECK_XOR           0x55U
+
+#define TPM2_START              0xC9U
+#define TPM2_TYPE_DATA          0xDAU
+#define TPM2_END                0x36U
+#define TPM2_HEADER_LEN         4U
+
+/* Private typedef -----------------------------------------------------------*/
+typedef enum
+{
+  PROTO_SYNC = 0,
+  PROTO_ADA_HEADER,
+  PROTO_TPM2_HEADER,
+  PROTO_PAYLOAD,
+  PROTO_TPM2_SKIP,
+  PROTO_TPM2_END
+} SerialProto_StateTypeDef;
+
+/* Private variables ---------------------------------------------------------*/
+static SerialProto_StateTypeDef state;
+static uint8_t header[ADA_HEADER_LEN];
+static uint8_t headerLen;
+static uint8_t isTpm2;
+
+/* Payload bytes still to come */
+static uint32_t payloadLeft;
+
+/* Destination, taken from the strip at the first payload byte */
+static uint8_t *frame;
+static uint32_t frameBytes;
+static uint32_t framePos;
+static uint8_t srcChannels;
+static uint8_t dstChannels;
+static uint8_t channel;
+
+/* Private function prototypes -----------------------------------------------*/
+static void SerialProto_StartPayload(uint32_t len, uint8_t channels);
+static void SerialProto_Write(const uint8_t *src, uint32_t len);
+static void SerialProto_EndFrame(uint8_t valid);
+
+/* Private user code ---------------------------------------------------------*/
+
+/**
+  * @brief  Drop any frame in progress and wait for a start byte.
+  * @retval None
+  */
+void SerialProto_Reset(void)
+{
+  if (frame != NULL)
+  {
+    USB_Frame_Submit(0U, NULL);
+    frame = NULL;
+  }
+  state = PROTO_SYNC;
+}
+
+/**
+  * @brief  A valid header was seen : the payload follows.
+  * @param  len: payload bytes
+  * @param  channels: bytes per pixel in the payload, 0 for the strip's own
+  * @retval None
+  */
+static void SerialProto_StartPayload(uint32_t len, uint8_t channels)
+{
+  payloadLeft = len;
+  srcChannels = channels;
+  frame = NULL;
+  state = (len != 0U) ? PROTO_PAYLOAD : PROTO_TPM2_END;
+}
+
+/**
+  * @brief  Store payload bytes, the part past the end of the strip is dropped.
+  *         RGB payload on an RGBW strip gets its white channel cleared.
+  * @param  src: payload bytes
+  * @param  len: number of bytes
+  * @retval None
+  */
+static void SerialProto_Write(const uint8_t *src, uint32_t len)
+{
+  if (srcChannels == dstChannels)
+  {
+    if (framePos < frameBytes)
+    {
+      uint32_t n = frameBytes - framePos;
+      memcpy(&frame[framePos], src, (len < n) ? len : n);
+    }
+    framePos += len;
+    return;
+  }
+
+  while (len--)
+  {
+    if (framePos < frameBytes)
+    {
+      frame[framePos] = *src;
+    }
+    src++;
+    framePos++;
+
+    if (++channel == srcChannels)
+    {
+      channel = 0U;
+      for (uint32_t c = srcChannels; c < dstChannels; c++)
+      {
+        if (framePos < frameBytes)
+        {
+          frame[framePos] = 0U;
+        }
+        framePos++;
+      }
+    }
+  }
+}
+
+/**
+  * @brief  The frame is complete, or broken.
+  * @param  valid: show the frame
+  * @retval None
+  */
+static void SerialProto_EndFrame(uint8_t valid)
+{
+  if (frame != NULL)
+  {
+    /* A short frame turns the rest of the strip off */
+    if (valid && (framePos < frameBytes))
+    {
+      memset(&frame[framePos], 0, frameBytes - framePos);
+    }
+    USB_Frame_Submit(valid, NULL);
+    frame = NULL;
+  }
+  state = PROTO_SYNC;
+}
+
+/**
+  * @brief  Parse received bytes.
+  * @param  data: bytes received
+  * @param  len: number of bytes
+  * @retval Bytes consumed. Less than len when the strip is not ready for the
+  *         next frame : feed the rest again later.
+  */
+uint16_t SerialProto_Feed(const uint8_t *data, uint16_t len)
+{
+  uint16_t i = 0U;
+
+  while (i < len)
+  {
+    uint8_t b = data[i];
+
+    switch (state)
+    {
+      case PROTO_SYNC:
+        i++;
+        if (b == 'A')
+        {
+          header[0] = b;
+          headerLen = 1U;
+          state = PROTO_ADA_HEADER;
+        }
+        else if (b == TPM2_START)
+        {
+          header[0] = b;
+          headerLen = 1U;
+          state = PROTO_TPM2_HEADER;
+        }
+        break;
+
+      case PROTO_ADA_HEADER:
+        /* Not "Ada" : look at this byte again as a possible start */
+        if (((headerLen == 1U) && (b != 'd')) || ((headerLen == 2U) && (b != 'a')))
+        {
+          state = PROTO_SYNC;
+          break;
+        }
+        header[headerLen++] = b;
+        i++;
+        if (headerLen == ADA_HEADER_LEN)
+        {
+          if (header[5] != (header[3] ^ header[4] ^ ADA_CHECK_XOR))
+          {
+            state = PROTO_SYNC;
+            break;
+          }
+          isTpm2 = 0U;
+          SerialProto_StartPayload((((uint32_t)header[3] << 8) + header[4] + 1U) * 3U, 3U);
+        }
+        break;
+
+      case PROTO_TPM2_HEADER:
+        header[headerLen++] = b;
+        i++;
+        if (headerLen == TPM2_HEADER_LEN)
+        {
+          uint32_t size = ((uint32_t)header[2] << 8) | header[3];
+
+          isTpm2 = 1U;
+          if (header[1] == TPM2_TYPE_DATA)
+          {
+            SerialProto_StartPayload(size, 0U);
+          }
+          else
+          {
+            payloadLeft = size;
+            state = (size != 0U) ? PROTO_TPM2_SKIP : PROTO_TPM2_END;
+          }
+        }
+        break;
+
+      case PROTO_PAYLOAD:
+        if (frame == NULL)
+        {
+          frame = USB_Frame_Acquire();
+          if (frame == NULL)
+          {
+            return i;
+          }
+          dstChannels = WS2812_GetFormat()->channels;
+          frameBytes = (uint32_t)WS2812_GetLength() * dstChannels;
+          framePos = 0U;
+          channel = 0U;
+          if (srcChannels == 0U)
+          {
+            srcChannels = dstChannels;
+          }
+        }
+        {
+          uint32_t n = len - i;
+
+          if (n > payloadLeft)
+          {
+            n = payloadLeft;
+          }
+          SerialProto_Write(&data[i], n);
+          i += n;
+          payloadLeft -= n;
+        }
+        if (payloadLeft == 0U)
+        {
+          if (isTpm2)
+          {
+            state = PROTO_TPM2_END;
+          }
+          else
+          {
+            SerialProto_EndFrame(1U);
+          }
+        }
+        break;
+
+      case PROTO_TPM2_SKIP:
+      {
+        uint32_t n = len - i;
+
+        if (n > payloadLeft)
+        {
+          n = payloadLeft;
+        }
+        i += n;
+        payloadLeft -= n;
+        if (payloadLeft == 0U)
+        {
+          state = PROTO_TPM2_END;
+        }
+        break;
+      }
+
+      case PROTO_TPM2_END:
+        /* Without its end byte the frame is dropped, the byte looked at again */
+        if (b == TPM2_END)
+        {
+          i++;
+          SerialProto_EndFrame(1U);
+        }
+        else
+        {
+          SerialProto_EndFrame(0U);
+        }
+        break;
+
+      default:
+        state = PROTO_SYNC;
+        break;
+    }
+  }
+
+  return i;
+}
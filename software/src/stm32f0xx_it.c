@@ -22,6 +22,12 @@
 #include "stm32f0xx_it.h"
 /* Private includes ----------------------------------------------------------*/
 /* USER CODE BEGIN Includes */
+#include "usb_frame.h"
+#include "usb_cdc.h"
+#include "usb_hid.h"
+#include "usb_sof.h"
+#include "cycle_count.h"
+#include "ws2812.h"
 /* USER CODE END Includes */
 
 /* Private typedef -----------------------------------------------------------*/
@@ -56,6 +62,8 @@
 
 /* External variables --------------------------------------------------------*/
 extern DMA_HandleTypeDef hdma_tim17_ch1_up;
+extern TIM_HandleTypeDef htim17;
+extern PCD_HandleTypeDef hpcd_USB_FS;
 /* USER CODE BEGIN EV */
 
 /* USER CODE END EV */
@@ -154,6 +162,72 @@ void DMA1_Channel1_IRQHandler(void)
   /* USER CODE END DMA1_Channel1_IRQn 1 */
 }
 
+/**
+  * @brief This function handles TIM17 global interrupt.
+  */
+void TIM17_IRQHandler(void)
+{
+  /* USER CODE BEGIN TIM17_IRQn 0 */
+
+  /* USER CODE END TIM17_IRQn 0 */
+  HAL_TIM_IRQHandler(&htim17);
+  /* USER CODE BEGIN TIM17_IRQn 1 */
+
+  /* USER CODE END TIM17_IRQn 1 */
+}
+
+/**
+  * @brief This function handles USB global interrupt / USB wake-up interrupt through EXTI line 18.
+  */
+void USB_IRQHandler(void)
+{
+  /* USER CODE BEGIN USB_IRQn 0 */
+  uint32_t start = CycleCount_Now();
+
+  USB_Sof_IrqEntry();
+
+  /* USER CODE END USB_IRQn 0 */
+  HAL_PCD_IRQHandler(&hpcd_USB_FS);
+  /* USER CODE BEGIN USB_IRQn 1 */
+  USB_Cdc_Poll();
+  USB_Hid_Poll();
+  USB_Frame_Arm();
+  USB_Frame_Poll();
+  USB_Frame_AccountIrq(CycleCount_Since(start));
+
+  /* USER CODE END USB_IRQn 1 */
+}
+
 /* USER CODE BEGIN 1 */
 
+/**
+  * @brief This function handles RCC and CRS global interrupts.
+  */
+void RCC_CRS_IRQHandler(void)
+{
+  HAL_RCCEx_CRS_IRQHandler();
+}
+
+#if (WS2812_OUTPUT == WS2812_OUTPUT_BSRR)
+/**
+  * @brief This function handles DMA1 channel 4, 5, 6 and 7 interrupts.
+  */
+void DMA1_Channel4_5_6_7_IRQHandler(void)
+{
+  WS2812_Bsrr_IRQHandler();
+}
+#elif (WS2812_OUTPUT == WS2812_OUTPUT_DMAR) || (WS2812_OUTPUT == WS2812_OUTPUT_SPI)
+/**
+  * @brief This function handles DMA1 channel 2 and 3 interrupts.
+  */
+void DMA1_Channel2_3_IRQHandler(void)
+{
+#if (WS2812_OUTPUT == WS2812_OUTPUT_DMAR)
+  WS2812_Dmar_IRQHandler();
+#else
+  WS2812_Spi_IRQHandler();
+#endif
+}
+#endif
+
 /* USER CODE END 1 */
@@ -0,0 +1,159 @@
+/**
+  ******************************************************************************
+  * @file    usb_cdc.c
+  * @brief   CDC-ACM serial port feeding the Adalight / tpm2 parser.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "usb_cdc.h"
+#include "serial_proto.h"
+
+/* Private define ------------------------------------------------------------*/
+#define USB_CDC_DTR             0x0001U
+
+/* Private variables ---------------------------------------------------------*/
+static uint8_t rxPacket[USB_CDC_DATA_EP_SIZE];
+static uint16_t rxLen;
+static uint16_t rxPos;
+static uint8_t rxHeld;
+
+/* 115200 8N1 until the host sets its own */
+static uint8_t lineCoding[7] = { 0x00, 0xC2, 0x01, 0x00, 0x00, 0x00, 0x08 };
+
+static const uint8_t greeting[4] = { 'A', 'd', 'a', '\n' };
+static volatile uint8_t txBusy;
+
+/* Private user code ---------------------------------------------------------*/
+
+/**
+  * @brief  Open or close the serial port endpoints.
+  * @param  config: 1 when the host selects the configuration, 0 on reset
+  * @retval None
+  */
+void USB_Cdc_Configure(uint8_t config)
+{
+  SerialProto_Reset();
+  rxHeld = 0U;
+  txBusy = 0U;
+
+  if (config)
+  {
+    HAL_PCD_EP_Open(&hpcd_USB_FS, USB_CDC_CMD_EP, USB_CDC_CMD_EP_SIZE, EP_TYPE_INTR);
+    HAL_PCD_EP_Open(&hpcd_USB_FS, USB_CDC_OUT_EP, USB_CDC_DATA_EP_SIZE, EP_TYPE_BULK);
+    HAL_PCD_EP_Open(&hpcd_USB_FS, USB_CDC_IN_EP, USB_CDC_DATA_EP_SIZE, EP_TYPE_BULK);
+    HAL_PCD_EP_Receive(&hpcd_USB_FS, USB_CDC_OUT_EP, rxPacket, sizeof(rxPacket));
+  }
+  else
+  {
+    HAL_PCD_EP_Close(&hpcd_USB_FS, USB_CDC_CMD_EP);
+    HAL_PCD_EP_Close(&hpcd_USB_FS, USB_CDC_OUT_EP);
+    HAL_PCD_EP_Close(&hpcd_USB_FS, USB_CDC_IN_EP);
+  }
+}
+
+/**
+  * @brief  Class requests to the communication interface.
+  * @param  req: SETUP packet
+  * @retval None
+  */
+void USB_Cdc_Setup(const USB_SetupTypeDef *req)
+{
+  if ((req->bmRequestType & USB_REQ_TYPE_MASK) != USB_REQ_TYPE_CLASS)
+  {
+    USB_Core_CtlError();
+    return;
+  }
+
+  switch (req->bRequest)
+  {
+    case USB_CDC_REQ_SET_LINE_CODING:
+      USB_Core_CtlReceive(lineCoding, (req->wLength < sizeof(lineCoding)) ? req->wLength : sizeof(lineCoding));
+      break;
+
+    case USB_CDC_REQ_GET_LINE_CODING:
+      USB_Core_CtlSend(lineCoding, sizeof(lineCoding));
+      break;
+
+    case USB_CDC_REQ_SET_CONTROL_LINE_STATE:
+      if (((req->wValue & USB_CDC_DTR) != 0U) && !txBusy)
+      {
+        txBusy = 1U;
+        HAL_PCD_EP_Transmit(&hpcd_USB_FS, USB_CDC_IN_EP, (uint8_t *)greeting, sizeof(greeting));
+      }
+      USB_Core_CtlStatus();
+      break;
+
+    case USB_CDC_REQ_SEND_BREAK:
+      USB_Core_CtlStatus();
+      break;
+
+    default:
+      USB_Core_CtlError();
+      break;
+  }
+}
+
+/**
+  * @brief  Data stage of SET_LINE_CODING received.
+  * @param  req: SETUP packet
+  * @retval None
+  */
+void USB_Cdc_CtlOut(const USB_SetupTypeDef *req)
+{
+  USB_Core_CtlStatus();
+}
+
+/**
+  * @brief  A packet came in on the data OUT endpoint.
+  * @param  epnum: endpoint number
+  * @retval None
+  */
+void USB_Cdc_DataOut(uint8_t epnum)
+{
+  if (epnum != (USB_CDC_OUT_EP & 0x7FU))
+  {
+    return;
+  }
+
+  rxLen = (uint16_t)hpcd_USB_FS.OUT_ep[epnum].xfer_count;
+  rxPos = 0U;
+  rxHeld = 1U;
+  USB_Cdc_Poll();
+}
+
+/**
+  * @brief  An IN transfer completed.
+  * @param  epnum: endpoint number
+  * @retval None
+  */
+void USB_Cdc_DataIn(uint8_t epnum)
+{
+  if (epnum == (USB_CDC_IN_EP & 0x7FU))
+  {
+    txBusy = 0U;
+  }
+}
+
+/**
+  * @brief  Parse the held packet, then let the host send the next one.
+  *         Runs from the USB interrupt, which is pended whenever the strip
+  *         may have become ready for a new frame.
+  * @retval None
+  */
+void USB_Cdc_Poll(void)
+{
+  if (!rxHeld)
+  {
+    return;
+  }
+
+  rxPos += SerialProto_Feed(&rxPacket[rxPos], rxLen - rxPos);
+  if (rxPos < rxLen)
+  {
+    return;
+  }
+
+  rxHeld = 0U;
+  HAL_PCD_EP_Receive(&hpcd_USB_FS, USB_CDC_OUT_EP, rxPacket, sizeof(rxPacket));
+}
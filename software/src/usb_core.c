@@ -0,0 +1,502 @@
+/**
+  ******************************************************************************
+  * @file    usb_core.c
+  * @brief   Minimal USB device layer on top of the HAL PCD driver.
+  ******************************************************************************
+  * The HAL PCD driver moves packets ; this file implements the control
+  * endpoint state machine and the standard requests, and routes everything
+  * else to the interface that owns it. Control transfers longer than one
+  * packet are split here, as the HAL does not continue them on EP0.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "usb_core.h"
+#include "usb_desc.h"
+#include "usb_frame.h"
+#include "usb_cdc.h"
+#include "usb_hid.h"
+#include "usb_iso.h"
+#include "usb_sof.h"
+
+/* Private define ------------------------------------------------------------*/
+#define USB_REQ_GET_STATUS          0x00U
+#define USB_REQ_CLEAR_FEATURE       0x01U
+#define USB_REQ_SET_FEATURE         0x03U
+#define USB_REQ_SET_ADDRESS         0x05U
+#define USB_REQ_GET_DESCRIPTOR      0x06U
+#define USB_REQ_GET_CONFIGURATION   0x08U
+#define USB_REQ_SET_CONFIGURATION   0x09U
+#define USB_REQ_GET_INTERFACE       0x0AU
+#define USB_REQ_SET_INTERFACE       0x0BU
+
+#define USB_FEATURE_EP_HALT         0x00U
+
+/* Private typedef -----------------------------------------------------------*/
+typedef enum
+{
+  USB_CTL_IDLE = 0,
+  USB_CTL_DATA_IN,
+  USB_CTL_DATA_OUT,
+  USB_CTL_STATUS
+} USB_CtlStateTypeDef;
+
+/* Private variables ---------------------------------------------------------*/
+static USB_SetupTypeDef setup;
+static USB_CtlStateTypeDef ctlState;
+static const uint8_t *ctlInData;
+static uint16_t ctlInRemain;
+static uint8_t ctlInZlp;
+static uint8_t *ctlOutData;
+static uint16_t ctlOutRemain;
+static uint8_t ctlReply[2];
+static uint8_t ctlInterface;
+static volatile uint8_t configuration;
+
+/* Private function prototypes -----------------------------------------------*/
+static void USB_Core_StdDevice(void);
+static void USB_Core_StdEndpoint(void);
+static void USB_Core_SetConfiguration(uint8_t config);
+static void USB_Core_Dispatch(void);
+
+/* Private user code ---------------------------------------------------------*/
+
+/**
+  * @brief  Lay out the packet memory and connect to the host.
+  *         To be called after MX_USB_PCD_Init().
+  * @retval None
+  */
+void USB_Core_Init(void)
+{
+  HAL_PCDEx_PMAConfig(&hpcd_USB_FS, 0x00U, PCD_SNG_BUF, USB_PMA_EP0_OUT);
+  HAL_PCDEx_PMAConfig(&hpcd_USB_FS, 0x80U, PCD_SNG_BUF, USB_PMA_EP0_IN);
+  HAL_PCDEx_PMAConfig(&hpcd_USB_FS, USB_FRAME_EP, PCD_DBL_BUF,
+                      (USB_PMA_FRAME_EP_BUF1 << 16) | USB_PMA_FRAME_EP_BUF0);
+  HAL_PCDEx_PMAConfig(&hpcd_USB_FS, USB_FRAME_STATUS_EP, PCD_SNG_BUF, USB_PMA_FRAME_STATUS);
+  HAL_PCDEx_PMAConfig(&hpcd_USB_FS, USB_CDC_CMD_EP, PCD_SNG_BUF, USB_PMA_CDC_CMD);
+  HAL_PCDEx_PMAConfig(&hpcd_USB_FS, USB_CDC_OUT_EP, PCD_SNG_BUF, USB_PMA_CDC_OUT);
+  HAL_PCDEx_PMAConfig(&hpcd_USB_FS, USB_CDC_IN_EP, PCD_SNG_BUF, USB_PMA_CDC_IN);
+  HAL_PCDEx_PMAConfig(&hpcd_USB_FS, USB_HID_OUT_EP, PCD_SNG_BUF, USB_PMA_HID_OUT);
+  HAL_PCDEx_PMAConfig(&hpcd_USB_FS, USB_HID_IN_EP, PCD_SNG_BUF, USB_PMA_HID_IN);
+  HAL_PCDEx_PMAConfig(&hpcd_USB_FS, USB_ISO_EP, PCD_DBL_BUF,
+                      (USB_PMA_ISO_BUF1 << 16) | USB_PMA_ISO_BUF0);
+
+  if (HAL_PCD_Start(&hpcd_USB_FS) != HAL_OK)
+  {
+    Error_Handler();
+  }
+}
+
+/**
+  * @brief  Tell whether the host has selected the configuration.
+  * @retval 1 once configured
+  */
+uint8_t USB_Core_IsConfigured(void)
+{
+  return configuration != 0U;
+}
+
+/**
+  * @brief  Start the IN data stage of the current control request.
+  *         Sent data is trimmed to wLength.
+  * @param  data: reply, must stay valid until sent
+  * @param  len: reply length
+  * @retval None
+  */
+void USB_Core_CtlSend(const uint8_t *data, uint16_t len)
+{
+  if (len > setup.wLength)
+  {
+    len = setup.wLength;
+  }
+
+  /* A reply shorter than asked ending on a full packet needs a ZLP */
+  ctlInZlp = (len < setup.wLength) && ((len % USB_EP0_SIZE) == 0U);
+  ctlInData = data;
+  ctlInRemain = len;
+  ctlState = USB_CTL_DATA_IN;
+
+  uint16_t chunk = (len > USB_EP0_SIZE) ? USB_EP0_SIZE : len;
+  HAL_PCD_EP_Transmit(&hpcd_USB_FS, 0x80U, (uint8_t *)data, chunk);
+}
+
+/**
+  * @brief  Start the OUT data stage of the current control request. The
+  *         owner is called back through its CtlOut handler once all is in.
+  * @param  data: buffer for wLength bytes
+  * @param  len: expected length
+  * @retval None
+  */
+void USB_Core_CtlReceive(uint8_t *data, uint16_t len)
+{
+  ctlOutData = data;
+  ctlOutRemain = len;
+  ctlState = USB_CTL_DATA_OUT;
+
+  uint16_t chunk = (len > USB_EP0_SIZE) ? USB_EP0_SIZE : len;
+  HAL_PCD_EP_Receive(&hpcd_USB_FS, 0x00U, data, chunk);
+}
+
+/**
+  * @brief  Acknowledge the current control request (status stage).
+  * @retval None
+  */
+void USB_Core_CtlStatus(void)
+{
+  ctlState = USB_CTL_STATUS;
+  HAL_PCD_EP_Transmit(&hpcd_USB_FS, 0x80U, NULL, 0U);
+}
+
+/**
+  * @brief  Reject the current control request.
+  * @retval None
+  */
+void USB_Core_CtlError(void)
+{
+  ctlState = USB_CTL_IDLE;
+  HAL_PCD_EP_SetStall(&hpcd_USB_FS, 0x80U);
+  HAL_PCD_EP_SetStall(&hpcd_USB_FS, 0x00U);
+}
+
+/**
+  * @brief  Open or close the endpoints of the interfaces.
+  * @param  config: 1 to configure, 0 to deconfigure
+  * @retval None
+  */
+static void USB_Core_SetConfiguration(uint8_t config)
+{
+  if (config == configuration)
+  {
+    return;
+  }
+
+  configuration = config;
+  USB_Frame_Configure(config);
+  USB_Cdc_Configure(config);
+  USB_Hid_Configure(config);
+  USB_Iso_Configure(config);
+}
+
+/**
+  * @brief  Standard requests addressed to the device.
+  * @retval None
+  */
+static void USB_Core_StdDevice(void)
+{
+  const uint8_t *desc;
+  uint16_t len;
+
+  switch (setup.bRequest)
+  {
+    case USB_REQ_GET_DESCRIPTOR:
+      desc = USB_Desc_Get(HIBYTE(setup.wValue), LOBYTE(setup.wValue), &len);
+      if (desc == NULL)
+      {
+        USB_Core_CtlError();
+      }
+      else
+      {
+        USB_Core_CtlSend(desc, len);
+      }
+      break;
+
+    case USB_REQ_SET_ADDRESS:
+      /* Applied by the HAL once the status stage is sent */
+      HAL_PCD_SetAddress(&hpcd_USB_FS, (uint8_t)(setup.wValue & 0x7FU));
+      USB_Core_CtlStatus();
+      break;
+
+    case USB_REQ_SET_CONFIGURATION:
+      if (setup.wValue > 1U)
+      {
+        USB_Core_CtlError();
+        break;
+      }
+      USB_Core_SetConfiguration((uint8_t)setup.wValue);
+      USB_Core_CtlStatus();
+      break;
+
+    case USB_REQ_GET_CONFIGURATION:
+      ctlReply[0] = configuration;
+      USB_Core_CtlSend(ctlReply, 1U);
+      break;
+
+    case USB_REQ_GET_STATUS:
+      ctlReply[0] = 0U;
+      ctlReply[1] = 0U;
+      USB_Core_CtlSend(ctlReply, 2U);
+      break;
+
+    default:
+      USB_Core_CtlError();
+      break;
+  }
+}
+
+/**
+  * @brief  Standard requests addressed to an endpoint.
+  * @retval None
+  */
+static void USB_Core_StdEndpoint(void)
+{
+  uint8_t ep = LOBYTE(setup.wIndex);
+  PCD_EPTypeDef *pep;
+
+  /* wIndex comes from the host : check it before indexing with it */
+  if ((ep & 0x7FU) >= hpcd_USB_FS.Init.dev_endpoints)
+  {
+    USB_Core_CtlError();
+    return;
+  }
+  pep = (ep & 0x80U) ? &hpcd_USB_FS.IN_ep[ep & 0x7FU] : &hpcd_USB_FS.OUT_ep[ep];
+
+  switch (setup.bRequest)
+  {
+    case USB_REQ_GET_STATUS:
+      ctlReply[0] = pep->is_stall;
+      ctlReply[1] = 0U;
+      USB_Core_CtlSend(ctlReply, 2U);
+      break;
+
+    case USB_REQ_SET_FEATURE:
+      if ((setup.wValue == USB_FEATURE_EP_HALT) && ((ep & 0x7FU) != 0U))
+      {
+        HAL_PCD_EP_SetStall(&hpcd_USB_FS, ep);
+      }
+      USB_Core_CtlStatus();
+      break;
+
+    case USB_REQ_CLEAR_FEATURE:
+      if ((setup.wValue == USB_FEATURE_EP_HALT) && ((ep & 0x7FU) != 0U))
+      {
+        HAL_PCD_EP_ClrStall(&hpcd_USB_FS, ep);
+      }
+      USB_Core_CtlStatus();
+      break;
+
+    default:
+      USB_Core_CtlError();
+      break;
+  }
+}
+
+/**
+  * @brief  Route the SETUP packet to its handler.
+  * @retval None
+  */
+static void USB_Core_Dispatch(void)
+{
+  uint8_t type = setup.bmRequestType & USB_REQ_TYPE_MASK;
+  uint8_t recipient = setup.bmRequestType & USB_REQ_RECIP_MASK;
+
+  if (type == USB_REQ_TYPE_STANDARD)
+  {
+    switch (recipient)
+    {
+      case USB_REQ_RECIP_DEVICE:
+        USB_Core_StdDevice();
+        return;
+
+      case USB_REQ_RECIP_ENDPOINT:
+        USB_Core_StdEndpoint();
+        return;
+
+      case USB_REQ_RECIP_INTERFACE:
+        if (LOBYTE(setup.wIndex) >= USB_NUM_INTERFACES)
+        {
+          break;
+        }
+        if (setup.bRequest == USB_REQ_GET_DESCRIPTOR)
+        {
+          /* HID class and report descriptors */
+          USB_Core_StdDevice();
+          return;
+        }
+        if (setup.bRequest == USB_REQ_GET_STATUS)
+        {
+          ctlReply[0] = 0U;
+          ctlReply[1] = 0U;
+          USB_Core_CtlSend(ctlReply, 2U);
+          return;
+        }
+        if (setup.bRequest == USB_REQ_GET_INTERFACE)
+        {
+          ctlReply[0] = (LOBYTE(setup.wIndex) == USB_ISO_INTERFACE) ? USB_Iso_GetAlt() : 0U;
+          USB_Core_CtlSend(ctlReply, 1U);
+          return;
+        }
+        if (setup.bRequest == USB_REQ_SET_INTERFACE)
+        {
+          if (LOBYTE(setup.wIndex) == USB_ISO_INTERFACE)
+          {
+            if (USB_Iso_SetAlt((uint8_t)setup.wValue) != HAL_OK)
+            {
+              break;
+            }
+          }
+          else if (setup.wValue != 0U)
+          {
+            break;
+          }
+          USB_Core_CtlStatus();
+          return;
+        }
+        break;
+
+      default:
+        break;
+    }
+  }
+  else if (configuration != 0U)
+  {
+    /* Class and vendor requests go to the interface that owns them, vendor
+       requests to the device being the frame interface's */
+    ctlInterface = (recipient == USB_REQ_RECIP_DEVICE) ? USB_FRAME_INTERFACE : LOBYTE(setup.wIndex);
+
+    if ((recipient == USB_REQ_RECIP_DEVICE) || (recipient == USB_REQ_RECIP_INTERFACE))
+    {
+      switch (ctlInterface)
+      {
+        case USB_FRAME_INTERFACE:
+          USB_Frame_Setup(&setup);
+          return;
+
+        case USB_CDC_COMM_INTERFACE:
+          USB_Cdc_Setup(&setup);
+          return;
+
+        case USB_HID_INTERFACE:
+          USB_Hid_Setup(&setup);
+          return;
+
+        default:
+          break;
+      }
+    }
+  }
+
+  USB_Core_CtlError();
+}
+
+void HAL_PCD_SetupStageCallback(PCD_HandleTypeDef *hpcd)
+{
+  const uint8_t *raw = (const uint8_t *)hpcd->Setup;
+
+  setup.bmRequestType = raw[0];
+  setup.bRequest = raw[1];
+  setup.wValue = (uint16_t)(raw[2] | (raw[3] << 8));
+  setup.wIndex = (uint16_t)(raw[4] | (raw[5] << 8));
+  setup.wLength = (uint16_t)(raw[6] | (raw[7] << 8));
+  ctlState = USB_CTL_IDLE;
+
+  USB_Core_Dispatch();
+}
+
+void HAL_PCD_DataInStageCallback(PCD_HandleTypeDef *hpcd, uint8_t epnum)
+{
+  if (epnum == (USB_FRAME_STATUS_EP & 0x7FU))
+  {
+    USB_Frame_DataIn(epnum);
+    return;
+  }
+  if (epnum == (USB_HID_IN_EP & 0x7FU))
+  {
+    USB_Hid_DataIn(epnum);
+    return;
+  }
+  if (epnum != 0U)
+  {
+    USB_Cdc_DataIn(epnum);
+    return;
+  }
+
+  if (ctlState != USB_CTL_DATA_IN)
+  {
+    ctlState = USB_CTL_IDLE;
+    return;
+  }
+
+  uint16_t sent = (ctlInRemain > USB_EP0_SIZE) ? USB_EP0_SIZE : ctlInRemain;
+  ctlInData += sent;
+  ctlInRemain -= sent;
+
+  if (ctlInRemain > 0U)
+  {
+    uint16_t chunk = (ctlInRemain > USB_EP0_SIZE) ? USB_EP0_SIZE : ctlInRemain;
+    HAL_PCD_EP_Transmit(hpcd, 0x80U, (uint8_t *)ctlInData, chunk);
+  }
+  else if (ctlInZlp)
+  {
+    ctlInZlp = 0U;
+    HAL_PCD_EP_Transmit(hpcd, 0x80U, NULL, 0U);
+  }
+  else
+  {
+    /* Host acknowledges with a zero-length OUT */
+    ctlState = USB_CTL_STATUS;
+    HAL_PCD_EP_Receive(hpcd, 0x00U, NULL, 0U);
+  }
+}
+
+void HAL_PCD_DataOutStageCallback(PCD_HandleTypeDef *hpcd, uint8_t epnum)
+{
+  if (epnum == (USB_FRAME_EP & 0x7FU))
+  {
+    USB_Frame_DataOut(epnum);
+    return;
+  }
+  if (epnum == (USB_HID_OUT_EP & 0x7FU))
+  {
+    USB_Hid_DataOut(epnum);
+    return;
+  }
+  if (epnum == (USB_ISO_EP & 0x7FU))
+  {
+    USB_Iso_DataOut(epnum);
+    return;
+  }
+  if (epnum != 0U)
+  {
+    USB_Cdc_DataOut(epnum);
+    return;
+  }
+
+  if (ctlState != USB_CTL_DATA_OUT)
+  {
+    return;
+  }
+
+  uint16_t count = (uint16_t)hpcd->OUT_ep[0].xfer_count;
+  if (count > ctlOutRemain)
+  {
+    count = ctlOutRemain;
+  }
+  ctlOutData += count;
+  ctlOutRemain -= count;
+
+  if ((ctlOutRemain > 0U) && (count == USB_EP0_SIZE))
+  {
+    uint16_t chunk = (ctlOutRemain > USB_EP0_SIZE) ? USB_EP0_SIZE : ctlOutRemain;
+    HAL_PCD_EP_Receive(hpcd, 0x00U, ctlOutData, chunk);
+    return;
+  }
+
+  if (ctlInterface == USB_CDC_COMM_INTERFACE)
+  {
+    USB_Cdc_CtlOut(&setup);
+  }
+  else
+  {
+    USB_Frame_CtlOut(&setup);
+  }
+}
+
+void HAL_PCD_ResetCallback(PCD_HandleTypeDef *hpcd)
+{
+  USB_Core_SetConfiguration(0U);
+  USB_Sof_Reset();
+  ctlState = USB_CTL_IDLE;
+
+  HAL_PCD_EP_Open(hpcd, 0x00U, USB_EP0_SIZE, EP_TYPE_CTRL);
+  HAL_PCD_EP_Open(hpcd, 0x80U, USB_EP0_SIZE, EP_TYPE_CTRL);
+}
@@ -0,0 +1,284 @@
+/**
+  ******************************************************************************
+  * @file    usb_desc.c
+  * @brief   USB descriptors of the controller.
+  ******************************************************************************
+  * One configuration, composite device :
+  *   - a vendor-specific interface : a bulk OUT endpoint receives pixel
+  *     frames, an interrupt IN endpoint reports frame credits and
+  *     completions, settings go through vendor control requests ;
+  *   - a CDC-ACM serial port (two interfaces tied by an IAD) taking the
+  *     Adalight and tpm2 framings used by existing ambilight software ;
+  *   - a vendor-defined HID interface taking chunked pixel updates in 64-byte
+  *     reports polled every 1 ms, usable without installing a driver ;
+  *   - a vendor-specific interface whose setting 1 opens an isochronous OUT
+  *     endpoint, for frames paced by the USB frame clock.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "usb_desc.h"
+#include "usb_core.h"
+
+/* Private define ------------------------------------------------------------*/
+#define USB_HID_REPORT_DESC_SIZE 27U
+#define USB_CONFIG_DESC_SIZE    (9U + (9U + 7U + 7U) + (8U + 9U + 5U + 5U + 4U + 5U + 7U + 9U + 7U + 7U) + \
+                                 (9U + 9U + 7U + 7U) + (9U + 9U + 7U))
+
+/* HID class descriptor, in the configuration and on its own */
+#define USB_HID_DESC_SIZE       9U
+#define USB_HID_DESC            USB_HID_DESC_SIZE, USB_DESC_HID, \
+                                0x11, 0x01,   /* HID 1.11 */ \
+                                0x00, 1, USB_DESC_HID_REPORT, \
+                                LOBYTE(USB_HID_REPORT_DESC_SIZE), HIBYTE(USB_HID_REPORT_DESC_SIZE)
+
+#define USB_STRING_MANUFACTURER 1U
+#define USB_STRING_PRODUCT      2U
+#define USB_STRING_SERIAL       3U
+
+/* Private variables ---------------------------------------------------------*/
+static const uint8_t deviceDesc[18] =
+{
+  18, USB_DESC_DEVICE,
+  0x00, 0x02,                   /* bcdUSB 2.00 */
+  0xEF, 0x02, 0x01,             /* composite device with IAD */
+  USB_EP0_SIZE,
+  LOBYTE(USB_VID), HIBYTE(USB_VID),
+  LOBYTE(USB_PID), HIBYTE(USB_PID),
+  0x00, 0x01,                   /* bcdDevice 1.00 */
+  USB_STRING_MANUFACTURER, USB_STRING_PRODUCT, USB_STRING_SERIAL,
+  1                             /* bNumConfigurations */
+};
+
+static const uint8_t configDesc[USB_CONFIG_DESC_SIZE] =
+{
+  9, USB_DESC_CONFIGURATION,
+  LOBYTE(USB_CONFIG_DESC_SIZE), HIBYTE(USB_CONFIG_DESC_SIZE),
+  USB_NUM_INTERFACES,
+  1,                            /* bConfigurationValue */
+  0,                            /* iConfiguration */
+  0x80,                         /* bus powered */
+  250,                          /* 500 mA */
+
+  /* Frame interface : vendor specific */
+  9, USB_DESC_INTERFACE,
+  USB_FRAME_INTERFACE, 0, 2,
+  0xFF, 0x00, 0x00,
+  0,
+
+  7, USB_DESC_ENDPOINT,
+  USB_FRAME_EP, 0x02,           /* bulk */
+  LOBYTE(USB_FRAME_EP_SIZE), HIBYTE(USB_FRAME_EP_SIZE),
+  0,
+
+  7, USB_DESC_ENDPOINT,
+  USB_FRAME_STATUS_EP, 0x03,    /* interrupt, every frame */
+  LOBYTE(USB_FRAME_STATUS_EP_SIZE), HIBYTE(USB_FRAME_STATUS_EP_SIZE),
+  1,
+
+  /* Serial port : CDC-ACM communication and data interfaces */
+  8, USB_DESC_IAD,
+  USB_CDC_COMM_INTERFACE, 2,
+  0x02, 0x02, 0x01,
+  0,
+
+  9, USB_DESC_INTERFACE,
+  USB_CDC_COMM_INTERFACE, 0, 1,
+  0x02, 0x02, 0x01,             /* CDC, ACM, AT commands */
+  0,
+
+  5, USB_DESC_CS_INTERFACE, 0x00,
+  0x10, 0x01,                   /* header, CDC 1.10 */
+
+  5, USB_DESC_CS_INTERFACE, 0x01,
+  0x00, USB_CDC_DATA_INTERFACE, /* call management */
+
+  4, USB_DESC_CS_INTERFACE, 0x02,
+  0x02,                         /* ACM : line coding and serial state */
+
+  5, USB_DESC_CS_INTERFACE, 0x06,
+  USB_CDC_COMM_INTERFACE, USB_CDC_DATA_INTERFACE,
+
+  7, USB_DESC_ENDPOINT,
+  USB_CDC_CMD_EP, 0x03,         /* interrupt */
+  LOBYTE(USB_CDC_CMD_EP_SIZE), HIBYTE(USB_CDC_CMD_EP_SIZE),
+  16,
+
+  9, USB_DESC_INTERFACE,
+  USB_CDC_DATA_INTERFACE, 0, 2,
+  0x0A, 0x00, 0x00,
+  0,
+
+  7, USB_DESC_ENDPOINT,
+  USB_CDC_OUT_EP, 0x02,
+  LOBYTE(USB_CDC_DATA_EP_SIZE), HIBYTE(USB_CDC_DATA_EP_SIZE),
+  0,
+
+  7, USB_DESC_ENDPOINT,
+  USB_CDC_IN_EP, 0x02,
+  LOBYTE(USB_CDC_DATA_EP_SIZE), HIBYTE(USB_CDC_DATA_EP_SIZE),
+  0,
+
+  /* Pixel reports : HID, no boot protocol */
+  9, USB_DESC_INTERFACE,
+  USB_HID_INTERFACE, 0, 2,
+  0x03, 0x00, 0x00,
+  0,
+
+  USB_HID_DESC,
+
+  7, USB_DESC_ENDPOINT,
+  USB_HID_OUT_EP, 0x03,         /* interrupt, every frame */
+  LOBYTE(USB_HID_EP_SIZE), HIBYTE(USB_HID_EP_SIZE),
+  1,
+
+  7, USB_DESC_ENDPOINT,
+  USB_HID_IN_EP, 0x03,
+  LOBYTE(USB_HID_EP_SIZE), HIBYTE(USB_HID_EP_SIZE),
+  1,
+
+  /* Isochronous frames : no bandwidth in setting 0 */
+  9, USB_DESC_INTERFACE,
+  USB_ISO_INTERFACE, 0, 0,
+  0xFF, 0x00, 0x00,
+  0,
+
+  9, USB_DESC_INTERFACE,
+  USB_ISO_INTERFACE, 1, 1,
+  0xFF, 0x00, 0x00,
+  0,
+
+  7, USB_DESC_ENDPOINT,
+  USB_ISO_EP, 0x01,             /* isochronous, no synchronisation */
+  LOBYTE(USB_ISO_EP_SIZE), HIBYTE(USB_ISO_EP_SIZE),
+  1
+};
+
+static const uint8_t hidDesc[USB_HID_DESC_SIZE] = { USB_HID_DESC };
+
+/* Vendor page, one 64-byte output report and one 64-byte input report */
+static const uint8_t hidReportDesc[USB_HID_REPORT_DESC_SIZE] =
+{
+  0x06, 0x00, 0xFF,             /* Usage Page (Vendor 0xFF00) */
+  0x09, 0x01,                   /* Usage (1) */
+  0xA1, 0x01,                   /* Collection (Application) */
+  0x15, 0x00,                   /*   Logical Minimum (0) */
+  0x26, 0xFF, 0x00,             /*   Logical Maximum (255) */
+  0x75, 0x08,                   /*   Report Size (8) */
+  0x95, USB_HID_EP_SIZE,        /*   Report Count (64) */
+  0x09, 0x02,                   /*   Usage (2) */
+  0x91, 0x02,                   /*   Output (Data, Var, Abs) */
+  0x95, USB_HID_EP_SIZE,        /*   Report Count (64) */
+  0x09, 0x03,                   /*   Usage (3) */
+  0x81, 0x02,                   /*   Input (Data, Var, Abs) */
+  0xC0                          /* End Collection */
+};
+
+static const uint8_t langIdDesc[4] = { 4, USB_DESC_STRING, 0x09, 0x04 };
+
+static const char *const strings[] =
+{
+  [USB_STRING_MANUFACTURER] = "Neopixel USB",
+  [USB_STRING_PRODUCT]      = "Neopixel USB LED controller",
+};
+
+/* Longest string is the 24-digit serial number */
+static uint8_t stringDesc[2U + 2U * 32U];
+
+/* Private function prototypes -----------------------------------------------*/
+static uint16_t USB_Desc_String(const char *str);
+static uint16_t USB_Desc_Serial(void);
+
+/* Private user code ---------------------------------------------------------*/
+
+/**
+  * @brief  Build a string descriptor from an ASCII string.
+  * @param  str: ASCII string
+  * @retval Descriptor length
+  */
+static uint16_t USB_Desc_String(const char *str)
+{
+  uint16_t len = 2U;
+
+  while ((*str != '\0') && (len < sizeof(stringDesc)))
+  {
+    stringDesc[len++] = (uint8_t)*str++;
+    stringDesc[len++] = 0U;
+  }
+  stringDesc[0] = (uint8_t)len;
+  stringDesc[1] = USB_DESC_STRING;
+  return len;
+}
+
+/**
+  * @brief  Build the serial number descriptor from the 96-bit unique ID.
+  * @retval Descriptor length
+  */
+static uint16_t USB_Desc_Serial(void)
+{
+  static const char hex[] = "0123456789ABCDEF";
+  const uint32_t *uid = (const uint32_t *)UID_BASE;
+  char serial[25];
+  uint32_t n = 0;
+
+  for (uint32_t w = 0; w < 3U; w++)
+  {
+    for (int32_t shift = 28; shift >= 0; shift -= 4)
+    {
+      serial[n++] = hex[(uid[w] >> shift) & 0x0FU];
+    }
+  }
+  serial[n] = '\0';
+
+  return USB_Desc_String(serial);
+}
+
+/**
+  * @brief  Get a descriptor for GET_DESCRIPTOR.
+  * @param  type: descriptor type
+  * @param  index: descriptor index
+  * @param  len: receives the descriptor length
+  * @retval Descriptor, NULL if there is none
+  */
+const uint8_t *USB_Desc_Get(uint8_t type, uint8_t index, uint16_t *len)
+{
+  switch (type)
+  {
+    case USB_DESC_DEVICE:
+      *len = sizeof(deviceDesc);
+      return deviceDesc;
+
+    case USB_DESC_CONFIGURATION:
+      *len = sizeof(configDesc);
+      return configDesc;
+
+    case USB_DESC_HID:
+      *len = sizeof(hidDesc);
+      return hidDesc;
+
+    case USB_DESC_HID_REPORT:
+      *len = sizeof(hidReportDesc);
+      return hidReportDesc;
+
+    case USB_DESC_STRING:
+      if (index == 0U)
+      {
+        *len = sizeof(langIdDesc);
+        return langIdDesc;
+      }
+      if (index == USB_STRING_SERIAL)
+      {
+        *len = USB_Desc_Serial();
+        return stringDesc;
+      }
+      if ((index < sizeof(strings) / sizeof(strings[0])) && (strings[index] != NULL))
+      {
+        *len = USB_Desc_String(strings[index]);
+        return stringDesc;
+      }
+      return NULL;
+
+    default:
+      return NULL;
+  }
+}
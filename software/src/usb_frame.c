@@ -0,0 +1,793 @@
+/**
+  ******************************************************************************
+  * @file    usb_frame.c
+  * @brief   Vendor interface streaming pixel frames to the WS2812 driver.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "usb_frame.h"
+#include "ws2812.h"
+#include "usb_sof.h"
+#include "clock_trim.h"
+#include "frame_codec.h"
+#include "frame_stream.h"
+#include "cycle_count.h"
+#include <string.h>
+
+/* Private variables ---------------------------------------------------------*/
+static volatile uint8_t armed;
+static USB_FrameInfoTypeDef info;
+static USB_FrameStatsTypeDef stats;
+static USB_FrameStatsTypeDef statsReply;
+
+/* With a double buffered endpoint the hardware may ACK one more packet after
+   the one ending a frame, before the endpoint is NAKed. When the next back
+   buffer is not free yet, that packet is parked here and copied in front of
+   the next frame. */
+static uint8_t carry[USB_FRAME_EP_SIZE];
+static uint16_t carryLen;
+
+/* The double buffered endpoint copies whole packets, whatever is left of
+   the transfer : the last partial packet of a raw frame goes to packet[]
+   first, and only its frame part is copied to rawTail */
+static uint8_t *rawTail;
+static uint16_t rawBodyLen;
+static uint16_t rawTailLen;
+static uint8_t rawTailIn;
+
+/* SET_ENCODING : frames come compressed and are decoded packet by packet */
+static uint8_t encoded;
+static uint8_t packet[USB_FRAME_EP_SIZE];
+static uint8_t packetsIn;
+static FrameCodec_StatusTypeDef decoded;
+
+/* SET_STREAM : frames of streamPixels go to the wire through the elastic
+   buffer as their packets arrive, one frame at a time */
+static uint16_t streamPixels;
+static uint8_t streamIn;
+static uint8_t streamShown = 1U;   /* 0 from Begin until on the wire */
+
+/* Back buffer lent to another interface for the frame it is receiving */
+static uint8_t lent;
+
+/* SET_PRESENT_AT : the next bulk frame is held until that SOF */
+static uint8_t atPending;
+static uint16_t atSof;
+static uint8_t held;
+static USB_SofStampTypeDef sofReply;
+static ClockTrim_StatsTypeDef clockReply;
+
+/* Credits : last report sent on the status endpoint */
+static uint32_t received;
+static USB_FrameStatusTypeDef report;
+static USB_FrameStatusTypeDef creditsReply;
+static uint8_t reportBusy;
+static uint8_t reportSent;
+
+/* Private function prototypes -----------------------------------------------*/
+static void USB_Frame_Open(void);
+static void USB_Frame_Park(void);
+static void USB_Frame_Show(void);
+static void USB_Frame_GetStatus(USB_FrameStatusTypeDef *status);
+static uint8_t USB_Frame_Decode(const uint8_t *data, uint16_t len);
+static void USB_Frame_ArmStream(void);
+static void USB_Frame_ReceiveRaw(uint8_t *dst, uint16_t len);
+static void USB_Frame_Stream(const uint8_t *data, uint16_t len);
+static void USB_Frame_StartStream(void);
+
+/* Private user code ---------------------------------------------------------*/
+
+/**
+  * @brief  (Re)open the frame endpoint, dropping any frame in progress.
+  * @retval None
+  */
+static void USB_Frame_Open(void)
+{
+  armed = 0U;
+  carryLen = 0U;
+  held = 0U;
+  atPending = 0U;
+  streamIn = 0U;
+  streamShown = 1U;
+
+  HAL_PCD_EP_Close(&hpcd_USB_FS, USB_FRAME_EP);
+  HAL_PCD_EP_Open(&hpcd_USB_FS, USB_FRAME_EP, USB_FRAME_EP_SIZE, EP_TYPE_BULK);
+
+  /* A double buffered endpoint opens VALID : hold the host off until armed */
+  PCD_SET_EP_RX_STATUS(hpcd_USB_FS.Instance, USB_FRAME_EP, USB_EP_RX_NAK);
+  USB_Frame_Park();
+  USB_Frame_Arm();
+}
+
+/**
+  * @brief  Point the endpoint at the carry buffer while no frame is armed.
+  * @retval None
+  */
+static void USB_Frame_Park(void)
+{
+  PCD_EPTypeDef *ep = &hpcd_USB_FS.OUT_ep[USB_FRAME_EP];
+
+  ep->xfer_buff = carry;
+  ep->xfer_len = USB_FRAME_EP_SIZE;
+  ep->xfer_count = 0U;
+}
+
+/**
+  * @brief  Open or close the frame endpoint.
+  * @param  config: 1 when the host selects the configuration, 0 on reset
+  * @retval None
+  */
+void USB_Frame_Configure(uint8_t config)
+{
+  received = 0U;
+  reportBusy = 0U;
+  reportSent = 0U;
+
+  if (config)
+  {
+    HAL_PCD_EP_Open(&hpcd_USB_FS, USB_FRAME_STATUS_EP, USB_FRAME_STATUS_EP_SIZE, EP_TYPE_INTR);
+    USB_Frame_Open();
+  }
+  else
+  {
+    armed = 0U;
+    lent = 0U;
+    held = 0U;
+    atPending = 0U;
+    streamIn = 0U;
+    streamShown = 1U;
+    HAL_PCD_EP_Close(&hpcd_USB_FS, USB_FRAME_EP);
+    HAL_PCD_EP_Close(&hpcd_USB_FS, USB_FRAME_STATUS_EP);
+  }
+}
+
+/**
+  * @brief  A bulk frame is complete : show it now, or at the SOF asked for.
+  * @retval None
+  */
+static void USB_Frame_Show(void)
+{
+  received++;
+
+  if (atPending)
+  {
+    atPending = 0U;
+    held = 1U;
+  }
+  else
+  {
+    WS2812_Present(NULL);
+  }
+}
+
+/**
+  * @brief  Start of a USB frame : show the held frame once its SOF is reached.
+  *         Called from USB_Sof_IrqEntry(), ahead of any packet processing.
+  * @param  frameNumber: number of the USB frame starting
+  * @retval None
+  */
+void USB_Frame_Sof(uint16_t frameNumber)
+{
+  if (held && USB_Sof_Reached(frameNumber, atSof))
+  {
+    held = 0U;
+    WS2812_Present(NULL);
+    USB_Frame_Arm();
+  }
+}
+
+/**
+  * @brief  Receive the next frame into the back buffer, if it is free.
+  *         Runs from the USB interrupt only, which is pended whenever the
+  *         back buffer may have become free.
+  * @retval None
+  */
+void USB_Frame_Arm(void)
+{
+  if (streamPixels != 0U)
+  {
+    USB_Frame_StartStream();
+    USB_Frame_ArmStream();
+    return;
+  }
+
+  while (!armed && !lent && !held && USB_Core_IsConfigured() && WS2812_CanRender())
+  {
+    uint8_t *buf = WS2812_GetBackBuffer();
+    uint16_t len = WS2812_GetLength() * WS2812_GetFormat()->channels;
+    uint16_t head = 0U;
+
+    if (len == 0U)
+    {
+      return;
+    }
+
+    if (encoded)
+    {
+      FrameCodec_Begin(buf, WS2812_GetLength(), WS2812_GetFormat()->channels);
+      decoded = FRAME_CODEC_BUSY;
+      packetsIn = 0U;
+
+      if (carryLen != 0U)
+      {
+        uint16_t parked = carryLen;
+
+        carryLen = 0U;
+        if (USB_Frame_Decode(carry, parked))
+        {
+          continue;
+        }
+      }
+
+      armed = 1U;
+      HAL_PCD_EP_Receive(&hpcd_USB_FS, USB_FRAME_EP, packet, USB_FRAME_EP_SIZE);
+      return;
+    }
+
+    if (carryLen != 0U)
+    {
+      head = (carryLen < len) ? carryLen : len;
+      memcpy(buf, carry, head);
+
+      /* A short parked packet is a whole frame by itself */
+      uint8_t complete = (head == len) || (carryLen < USB_FRAME_EP_SIZE);
+      carryLen = 0U;
+      if (complete)
+      {
+        USB_Frame_Show();
+        continue;
+      }
+    }
+
+    armed = 1U;
+    USB_Frame_ReceiveRaw(buf + head, len - head);
+  }
+}
+
+/**
+  * @brief  Receive the rest of a raw frame : whole packets in place, the
+  *         last partial one through packet[] so that no byte past the frame
+  *         is written.
+  * @param  dst: where the frame goes on
+  * @param  len: bytes left in the frame
+  * @retval None
+  */
+static void USB_Frame_ReceiveRaw(uint8_t *dst, uint16_t len)
+{
+  uint16_t body = len - (len % USB_FRAME_EP_SIZE);
+
+  rawTail = dst + body;
+  rawBodyLen = body;
+  rawTailLen = len - body;
+  rawTailIn = (body == 0U);
+
+  if (rawTailIn)
+  {
+    HAL_PCD_EP_Receive(&hpcd_USB_FS, USB_FRAME_EP, packet, USB_FRAME_EP_SIZE);
+  }
+  else
+  {
+    HAL_PCD_EP_Receive(&hpcd_USB_FS, USB_FRAME_EP, dst, body);
+  }
+}
+
+/**
+  * @brief  Receive the next packet of a streamed frame, if the elastic buffer
+  *         has room for it. A new frame begins once the last one is latched.
+  * @retval None
+  */
+static void USB_Frame_ArmStream(void)
+{
+  while (!armed && !lent && USB_Core_IsConfigured())
+  {
+    if (!streamIn)
+    {
+      /* The frame received last must have gone out, and be off the wire */
+      if (!streamShown || WS2812_IsBusy() || !WS2812_CanRender())
+      {
+        return;
+      }
+      FrameStream_Begin((uint32_t)streamPixels * WS2812_GetFormat()->channels);
+      streamIn = 1U;
+      streamShown = 0U;
+    }
+
+    if (carryLen != 0U)
+    {
+      uint16_t parked = carryLen;
+
+      if (!FrameStream_Reserve(parked))
+      {
+        return;
+      }
+      carryLen = 0U;
+      USB_Frame_Stream(carry, parked);
+      continue;
+    }
+
+    if (!FrameStream_Reserve(USB_FRAME_EP_SIZE))
+    {
+      return;
+    }
+    armed = 1U;
+    HAL_PCD_EP_Receive(&hpcd_USB_FS, USB_FRAME_EP, packet, USB_FRAME_EP_SIZE);
+  }
+}
+
+/**
+  * @brief  Queue one packet of a streamed frame, and start the frame on the
+  *         wire once enough of it is in.
+  * @param  data: packet
+  * @param  len: packet length, a short packet ends the frame
+  * @retval None
+  */
+static void USB_Frame_Stream(const uint8_t *data, uint16_t len)
+{
+  if (FrameStream_Push(data, len, len < USB_FRAME_EP_SIZE))
+  {
+    streamIn = 0U;
+    received++;
+  }
+
+  USB_Frame_StartStream();
+}
+
+/**
+  * @brief  Start the streamed frame on the wire once enough of it is in.
+  *         While the strip is taken, e.g. by a frame from another interface,
+  *         it is retried from USB_Frame_Arm(), pended at every latch.
+  * @retval None
+  */
+static void USB_Frame_StartStream(void)
+{
+  HAL_StatusTypeDef status;
+
+  if (streamShown || (streamIn && (FrameStream_Level() < FRAME_STREAM_PREFILL)))
+  {
+    return;
+  }
+
+  status = WS2812_PresentStream(streamPixels, FrameStream_Fetch, NULL);
+  if (status == HAL_OK)
+  {
+    stats.streamFrames++;
+  }
+
+  /* Anything but a busy strip is final : the frame is dropped */
+  if (status != HAL_BUSY)
+  {
+    streamShown = 1U;
+  }
+}
+
+/**
+  * @brief  Decode one packet of a compressed frame. The transfer, hence the
+  *         frame, ends on a short packet : it is shown if it decoded whole.
+  * @param  data: packet
+  * @param  len: packet length
+  * @retval 1 at the end of the frame, 0 if more packets follow
+  */
+static uint8_t USB_Frame_Decode(const uint8_t *data, uint16_t len)
+{
+  packetsIn++;
+
+  if (decoded == FRAME_CODEC_BUSY)
+  {
+    uint32_t start = CycleCount_Now();
+
+    decoded = FrameCodec_Feed(data, len);
+    stats.decodeCycles += CycleCount_Since(start);
+  }
+
+  if (len == USB_FRAME_EP_SIZE)
+  {
+    return 0U;
+  }
+
+  if (decoded == FRAME_CODEC_DONE)
+  {
+    stats.decodeFrames++;
+    USB_Frame_Show();
+  }
+  else
+  {
+    /* Still counted, the host does not know it was dropped */
+    stats.decodeErrors++;
+    received++;
+  }
+  return 1U;
+}
+
+/**
+  * @brief  Lend the back buffer to another interface for one frame. The bulk
+  *         endpoint gives it up only between two of its own transfers.
+  *         Must be followed by USB_Frame_Submit().
+  * @retval Back buffer, NULL if it is not available yet
+  */
+uint8_t *USB_Frame_Acquire(void)
+{
+  if (!lent)
+  {
+    if (!WS2812_CanRender() || (carryLen != 0U) || held || (streamPixels != 0U))
+    {
+      return NULL;
+    }
+
+    if (armed)
+    {
+      /* Only take the buffer back if no packet of a bulk frame is in */
+      if ((hpcd_USB_FS.OUT_ep[USB_FRAME_EP].xfer_count != 0U) || (packetsIn != 0U) ||
+          (!encoded && (rawTail - rawBodyLen != WS2812_GetBackBuffer())) ||
+          (!encoded && rawTailIn && (rawBodyLen != 0U)) ||
+          ((PCD_GET_ENDPOINT(hpcd_USB_FS.Instance, USB_FRAME_EP) & USB_EP_CTR_RX) != 0U))
+      {
+        return NULL;
+      }
+
+      /* A packet ACKed meanwhile goes to the carry buffer */
+      PCD_SET_EP_RX_STATUS(hpcd_USB_FS.Instance, USB_FRAME_EP, USB_EP_RX_NAK);
+      armed = 0U;
+      USB_Frame_Park();
+    }
+
+    lent = 1U;
+  }
+
+  return WS2812_GetBackBuffer();
+}
+
+/**
+  * @brief  Give back the buffer taken by USB_Frame_Acquire().
+  * @param  present: show the frame written into it, or drop it
+  * @param  fence: if not NULL, receives the fence of the frame shown
+  * @retval None
+  */
+void USB_Frame_Submit(uint8_t present, uint32_t *fence)
+{
+  if (!lent)
+  {
+    return;
+  }
+
+  lent = 0U;
+  if (present)
+  {
+    WS2812_Present(fence);
+  }
+  USB_Frame_Arm();
+}
+
+/**
+  * @brief  A frame transfer ended : show it and wait for the next one.
+  * @param  epnum: endpoint number
+  * @retval None
+  */
+void USB_Frame_DataOut(uint8_t epnum)
+{
+  if (epnum != (USB_FRAME_EP & 0x7FU))
+  {
+    return;
+  }
+
+  /* The HAL only NAKs a full-length transfer, not one ended short */
+  PCD_SET_EP_RX_STATUS(hpcd_USB_FS.Instance, USB_FRAME_EP, USB_EP_RX_NAK);
+
+  uint16_t count = (uint16_t)hpcd_USB_FS.OUT_ep[USB_FRAME_EP].xfer_count;
+
+  stats.usbBytes += count;
+
+  if (!armed)
+  {
+    carryLen = count;
+  }
+  else if (streamPixels != 0U)
+  {
+    armed = 0U;
+    USB_Frame_Stream(packet, count);
+  }
+  else if (!encoded)
+  {
+    if (rawTailIn)
+    {
+      memcpy(rawTail, packet, (count < rawTailLen) ? count : rawTailLen);
+    }
+    else if ((count == rawBodyLen) && (rawTailLen != 0U))
+    {
+      /* Whole packets are in, the partial one follows */
+      rawTailIn = 1U;
+      HAL_PCD_EP_Receive(&hpcd_USB_FS, USB_FRAME_EP, packet, USB_FRAME_EP_SIZE);
+      return;
+    }
+    armed = 0U;
+    USB_Frame_Show();
+  }
+  else if (USB_Frame_Decode(packet, count))
+  {
+    armed = 0U;
+  }
+  else
+  {
+    HAL_PCD_EP_Receive(&hpcd_USB_FS, USB_FRAME_EP, packet, USB_FRAME_EP_SIZE);
+    return;
+  }
+
+  USB_Frame_Arm();
+  if (!armed)
+  {
+    USB_Frame_Park();
+  }
+}
+
+/**
+  * @brief  Current credits. The receiving back buffer, or the elastic buffer
+  *         in stream mode, is the only frame slot.
+  * @param  status: receives the counters
+  * @retval None
+  */
+static void USB_Frame_GetStatus(USB_FrameStatusTypeDef *status)
+{
+  uint8_t open = (streamPixels != 0U) ? streamIn : armed;
+
+  status->framesReceived = received;
+  status->frameLimit = received + (open ? 1U : 0U);
+  status->framesDone = WS2812_GetFramesDone();
+}
+
+/**
+  * @brief  Send a status report when the credits or the frame count moved.
+  *         Runs at the end of every USB interrupt, which a latched frame
+  *         pends through WS2812_FrameDoneCallback().
+  * @retval None
+  */
+void USB_Frame_Poll(void)
+{
+  USB_FrameStatusTypeDef now;
+
+  if (reportBusy || !USB_Core_IsConfigured())
+  {
+    return;
+  }
+
+  USB_Frame_GetStatus(&now);
+  if (reportSent && (memcmp(&now, &report, sizeof(report)) == 0))
+  {
+    return;
+  }
+
+  report = now;
+  reportSent = 1U;
+  reportBusy = 1U;
+  HAL_PCD_EP_Transmit(&hpcd_USB_FS, USB_FRAME_STATUS_EP, (uint8_t *)&report, sizeof(report));
+}
+
+/**
+  * @brief  A status report was sent.
+  * @param  epnum: endpoint number
+  * @retval None
+  */
+void USB_Frame_DataIn(uint8_t epnum)
+{
+  if (epnum == (USB_FRAME_STATUS_EP & 0x7FU))
+  {
+    reportBusy = 0U;
+    USB_Frame_Poll();
+  }
+}
+
+/**
+  * @brief  Account the CPU time of one USB interrupt.
+  * @param  cycles: cycles spent in the handler
+  * @retval None
+  */
+void USB_Frame_AccountIrq(uint32_t cycles)
+{
+  stats.usbCycles += cycles;
+}
+
+/**
+  * @brief  Vendor requests to the frame interface.
+  * @param  req: SETUP packet
+  * @retval None
+  */
+void USB_Frame_Setup(const USB_SetupTypeDef *req)
+{
+  HAL_StatusTypeDef status = HAL_OK;
+
+  if ((req->bmRequestType & USB_REQ_TYPE_MASK) != USB_REQ_TYPE_VENDOR)
+  {
+    USB_Core_CtlError();
+    return;
+  }
+
+  switch (req->bRequest)
+  {
+    case USB_FRAME_REQ_SET_LENGTH:
+      status = WS2812_SetLength(req->wValue);
+      break;
+
+    case USB_FRAME_REQ_SET_FORMAT:
+      switch (req->wValue)
+      {
+        case USB_FRAME_FORMAT_GRB:
+          status = WS2812_SetFormat(&WS2812_FormatGRB);
+          break;
+        case USB_FRAME_FORMAT_RGB:
+          status = WS2812_SetFormat(&WS2812_FormatRGB);
+          break;
+        case USB_FRAME_FORMAT_BRG:
+          status = WS2812_SetFormat(&WS2812_FormatBRG);
+          break;
+        case USB_FRAME_FORMAT_GRBW:
+          status = WS2812_SetFormat(&WS2812_FormatGRBW);
+          break;
+        default:
+          status = HAL_ERROR;
+          break;
+      }
+      break;
+
+    case USB_FRAME_REQ_SET_BRIGHTNESS:
+      if (req->wValue > 0xFFU)
+      {
+        status = HAL_ERROR;
+        break;
+      }
+      WS2812_SetBrightness((uint8_t)req->wValue);
+      break;
+
+    case USB_FRAME_REQ_SET_GAMMA:
+      if (req->wValue == USB_FRAME_GAMMA_LINEAR)
+      {
+        WS2812_SetGamma(NULL);
+      }
+      else if (req->wValue == USB_FRAME_GAMMA_28)
+      {
+        WS2812_SetGamma(WS2812_Gamma28);
+      }
+      else
+      {
+        status = HAL_ERROR;
+      }
+      break;
+
+    case USB_FRAME_REQ_SET_DITHER:
+      /* Dithering keeps the strip busy : no streamed frame could start */
+      if ((req->wValue != 0U) && (streamPixels != 0U))
+      {
+        status = HAL_ERROR;
+        break;
+      }
+      WS2812_SetDither(req->wValue != 0U);
+      break;
+
+    case USB_FRAME_REQ_SET_ENCODING:
+      encoded = (req->wValue != 0U) ? 1U : 0U;
+      break;
+
+    case USB_FRAME_REQ_SET_STREAM:
+      /* The parallel engines read the chain out of order */
+      if ((req->wValue != 0U) && ((WS2812_OUTPUTS != 1U) || WS2812_GetDither()))
+      {
+        status = HAL_ERROR;
+        break;
+      }
+      streamPixels = req->wValue;
+      atPending = 0U;
+      break;
+
+    case USB_FRAME_REQ_GET_INFO:
+      info.maxPixels = WS2812_PIXELS;
+      info.length = WS2812_GetLength();
+      info.channels = WS2812_GetFormat()->channels;
+      info.brightness = WS2812_GetBrightness();
+      info.framesDone = WS2812_GetFramesDone();
+      info.output = WS2812_OUTPUT;
+      info.outputs = WS2812_OUTPUTS;
+      info.ringBytes = WS2812_OUTPUT_RING_BYTES;
+      info.dmaPerByte = WS2812_OUTPUT_DMA_PER_BYTE;
+      info.streamBytes = (WS2812_OUTPUTS == 1U) ? FRAME_STREAM_BYTES : 0U;
+      USB_Core_CtlSend((const uint8_t *)&info, sizeof(info));
+      return;
+
+    case USB_FRAME_REQ_SET_PRESENT_AT:
+      /* A streamed frame starts as it arrives, it cannot be held */
+      if (streamPixels != 0U)
+      {
+        status = HAL_ERROR;
+        break;
+      }
+      atSof = req->wValue & USB_SOF_NUMBER_MASK;
+      atPending = 1U;
+      break;
+
+    case USB_FRAME_REQ_GET_SOF:
+      USB_Sof_GetStamp(&sofReply);
+      USB_Core_CtlSend((const uint8_t *)&sofReply, sizeof(sofReply));
+      return;
+
+    case USB_FRAME_REQ_GET_CLOCK:
+      ClockTrim_GetStats(&clockReply, req->wValue != 0U);
+      USB_Core_CtlSend((const uint8_t *)&clockReply, sizeof(clockReply));
+      return;
+
+    case USB_FRAME_REQ_GET_CREDITS:
+      USB_Frame_GetStatus(&creditsReply);
+      USB_Core_CtlSend((const uint8_t *)&creditsReply, sizeof(creditsReply));
+      return;
+
+    case USB_FRAME_REQ_GET_STATS:
+    {
+      WS2812_StatsTypeDef encode;
+      FrameStream_StatsTypeDef stream;
+
+      WS2812_GetStats(&encode, req->wValue != 0U);
+      FrameStream_GetStats(&stream, req->wValue != 0U);
+      statsReply = stats;
+      statsReply.encodeCycles = encode.cycles;
+      statsReply.encodePixels = encode.pixels;
+      statsReply.streamUnderruns = stream.underruns;
+      statsReply.streamMinLevel = stream.minLevel;
+      if (req->wValue != 0U)
+      {
+        stats.usbCycles = 0U;
+        stats.usbBytes = 0U;
+        stats.decodeCycles = 0U;
+        stats.decodeFrames = 0U;
+        stats.decodeErrors = 0U;
+        stats.streamFrames = 0U;
+      }
+      USB_Core_CtlSend((const uint8_t *)&statsReply, sizeof(statsReply));
+      return;
+    }
+
+    default:
+      status = HAL_ERROR;
+      break;
+  }
+
+  if (status != HAL_OK)
+  {
+    USB_Core_CtlError();
+    return;
+  }
+
+  /* The frame size may have changed : restart the frame being received */
+  if ((req->bRequest == USB_FRAME_REQ_SET_LENGTH) || (req->bRequest == USB_FRAME_REQ_SET_FORMAT) ||
+      (req->bRequest == USB_FRAME_REQ_SET_ENCODING) || (req->bRequest == USB_FRAME_REQ_SET_STREAM))
+  {
+    USB_Frame_Open();
+  }
+
+  USB_Core_CtlStatus();
+}
+
+/**
+  * @brief  Data stage of a host-to-device request completed. None of the
+  *         current requests carry data.
+  * @param  req: SETUP packet
+  * @retval None
+  */
+void USB_Frame_CtlOut(const USB_SetupTypeDef *req)
+{
+  USB_Core_CtlStatus();
+}
+
+/**
+  * @brief  The back buffer is free again once a frame has been latched.
+  * @retval None
+  */
+void WS2812_FrameDoneCallback(void)
+{
+  /* Arm from the USB interrupt, not from under a transfer in progress */
+  HAL_NVIC_SetPendingIRQ(USB_IRQn);
+}
+
+/**
+  * @brief  The wire drained room for the next streamed packet.
+  * @retval None
+  */
+void FrameStream_RoomCallback(void)
+{
+  HAL_NVIC_SetPendingIRQ(USB_IRQn);
+}
@@ -0,0 +1,235 @@
+/**
+  ******************************************************************************
+  * @file    usb_hid.c
+  * @brief   Vendor-defined HID interface taking chunked pixel updates.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "usb_hid.h"
+#include "usb_frame.h"
+#include "ws2812.h"
+#include <string.h>
+
+/* Private variables ---------------------------------------------------------*/
+static uint8_t outReport[USB_HID_EP_SIZE];
+static uint16_t outLen;
+static uint8_t outHeld;
+
+/* Back buffer while a frame is being written */
+static uint8_t *frame;
+
+/* Frame shown, waiting for its completion report */
+static uint32_t doneFence;
+static uint8_t doneSeq;
+static uint8_t doneWaiting;
+
+static uint8_t inReport[USB_HID_EP_SIZE];
+static uint8_t inReportReply[USB_HID_EP_SIZE];
+static volatile uint8_t txBusy;
+static uint8_t idleRate;
+static uint8_t protocol = 1U;
+
+/* Private function prototypes -----------------------------------------------*/
+static uint8_t USB_Hid_Apply(void);
+
+/* Private user code ---------------------------------------------------------*/
+
+/**
+  * @brief  Open or close the report endpoints.
+  * @param  config: 1 when the host selects the configuration, 0 on reset
+  * @retval None
+  */
+void USB_Hid_Configure(uint8_t config)
+{
+  if (frame != NULL)
+  {
+    USB_Frame_Submit(0U, NULL);
+    frame = NULL;
+  }
+  outHeld = 0U;
+  doneWaiting = 0U;
+  txBusy = 0U;
+
+  if (config)
+  {
+    HAL_PCD_EP_Open(&hpcd_USB_FS, USB_HID_OUT_EP, USB_HID_EP_SIZE, EP_TYPE_INTR);
+    HAL_PCD_EP_Open(&hpcd_USB_FS, USB_HID_IN_EP, USB_HID_EP_SIZE, EP_TYPE_INTR);
+    HAL_PCD_EP_Receive(&hpcd_USB_FS, USB_HID_OUT_EP, outReport, sizeof(outReport));
+  }
+  else
+  {
+    HAL_PCD_EP_Close(&hpcd_USB_FS, USB_HID_OUT_EP);
+    HAL_PCD_EP_Close(&hpcd_USB_FS, USB_HID_IN_EP);
+  }
+}
+
+/**
+  * @brief  Class requests to the HID interface. Output reports only travel
+  *         on the interrupt endpoint ; GET_REPORT returns the last input
+  *         report, all zero before the first one.
+  * @param  req: SETUP packet
+  * @retval None
+  */
+void USB_Hid_Setup(const USB_SetupTypeDef *req)
+{
+  if ((req->bmRequestType & USB_REQ_TYPE_MASK) != USB_REQ_TYPE_CLASS)
+  {
+    USB_Core_CtlError();
+    return;
+  }
+
+  switch (req->bRequest)
+  {
+    case USB_HID_REQ_GET_REPORT:
+      if (HIBYTE(req->wValue) != USB_HID_REPORT_INPUT)
+      {
+        USB_Core_CtlError();
+        break;
+      }
+      /* A copy : the endpoint may send the next one meanwhile */
+      memcpy(inReportReply, inReport, sizeof(inReportReply));
+      USB_Core_CtlSend(inReportReply, sizeof(inReportReply));
+      break;
+
+    case USB_HID_REQ_SET_IDLE:
+      idleRate = HIBYTE(req->wValue);
+      USB_Core_CtlStatus();
+      break;
+
+    case USB_HID_REQ_GET_IDLE:
+      USB_Core_CtlSend(&idleRate, 1U);
+      break;
+
+    case USB_HID_REQ_SET_PROTOCOL:
+      protocol = LOBYTE(req->wValue);
+      USB_Core_CtlStatus();
+      break;
+
+    case USB_HID_REQ_GET_PROTOCOL:
+      USB_Core_CtlSend(&protocol, 1U);
+      break;
+
+    default:
+      USB_Core_CtlError();
+      break;
+  }
+}
+
+/**
+  * @brief  An output report came in.
+  * @param  epnum: endpoint number
+  * @retval None
+  */
+void USB_Hid_DataOut(uint8_t epnum)
+{
+  if (epnum != (USB_HID_OUT_EP & 0x7FU))
+  {
+    return;
+  }
+
+  outLen = (uint16_t)hpcd_USB_FS.OUT_ep[epnum].xfer_count;
+  outHeld = 1U;
+  USB_Hid_Poll();
+}
+
+/**
+  * @brief  An input report was sent.
+  * @param  epnum: endpoint number
+  * @retval None
+  */
+void USB_Hid_DataIn(uint8_t epnum)
+{
+  if (epnum == (USB_HID_IN_EP & 0x7FU))
+  {
+    txBusy = 0U;
+    USB_Hid_Poll();
+  }
+}
+
+/**
+  * @brief  Write the held report into the frame.
+  * @retval 0 if it has to wait for the strip, 1 once consumed
+  */
+static uint8_t USB_Hid_Apply(void)
+{
+  if (outLen < USB_HID_HEADER_SIZE)
+  {
+    return 1U;
+  }
+
+  uint8_t flags = outReport[0];
+  uint32_t len = outReport[2];
+  uint32_t offset = outReport[3] | ((uint32_t)outReport[4] << 8);
+
+  /* One frame in flight : the next one waits for the completion report */
+  if ((flags & USB_HID_FLAG_PRESENT) && doneWaiting)
+  {
+    return 0U;
+  }
+
+  if (frame == NULL)
+  {
+    frame = USB_Frame_Acquire();
+    if (frame == NULL)
+    {
+      return 0U;
+    }
+    WS2812_SyncBackBuffer();
+  }
+
+  uint32_t frameBytes = (uint32_t)WS2812_GetLength() * WS2812_GetFormat()->channels;
+
+  if (len > (uint32_t)(outLen - USB_HID_HEADER_SIZE))
+  {
+    len = outLen - USB_HID_HEADER_SIZE;
+  }
+  if (offset < frameBytes)
+  {
+    if (len > frameBytes - offset)
+    {
+      len = frameBytes - offset;
+    }
+    memcpy(&frame[offset], &outReport[USB_HID_HEADER_SIZE], len);
+  }
+
+  if (flags & USB_HID_FLAG_PRESENT)
+  {
+    USB_Frame_Submit(1U, &doneFence);
+    frame = NULL;
+    doneSeq = outReport[1];
+    doneWaiting = 1U;
+  }
+
+  return 1U;
+}
+
+/**
+  * @brief  Report shown frames, then take the held report if the strip can.
+  *         Runs from the USB interrupt, which is pended at every frame end.
+  * @retval None
+  */
+void USB_Hid_Poll(void)
+{
+  if (doneWaiting && !txBusy && WS2812_FenceReached(doneFence))
+  {
+    uint32_t done = WS2812_GetFramesDone();
+
+    memset(inReport, 0, sizeof(inReport));
+    inReport[0] = USB_HID_IN_FRAME_DONE;
+    inReport[1] = doneSeq;
+    inReport[2] = (uint8_t)done;
+    inReport[3] = (uint8_t)(done >> 8);
+    inReport[4] = (uint8_t)(done >> 16);
+    inReport[5] = (uint8_t)(done >> 24);
+    doneWaiting = 0U;
+    txBusy = 1U;
+    HAL_PCD_EP_Transmit(&hpcd_USB_FS, USB_HID_IN_EP, inReport, sizeof(inReport));
+  }
+
+  if (outHeld && USB_Hid_Apply())
+  {
+    outHeld = 0U;
+    HAL_PCD_EP_Receive(&hpcd_USB_FS, USB_HID_OUT_EP, outReport, sizeof(outReport));
+  }
+}
@@ -0,0 +1,175 @@
+/**
+  ******************************************************************************
+  * @file    usb_iso.c
+  * @brief   Isochronous frame interface, rate-locked to the USB frame clock.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "usb_iso.h"
+#include "usb_frame.h"
+#include "usb_sof.h"
+#include "ws2812.h"
+#include <string.h>
+
+/* Private variables ---------------------------------------------------------*/
+static uint8_t packet[USB_ISO_EP_SIZE];
+static uint8_t altSetting;
+
+/* Frame being assembled in the back buffer */
+static uint8_t *frame;
+static uint8_t frameSeq;
+static uint16_t showAt;
+static volatile uint8_t scheduled;
+
+/* Private function prototypes -----------------------------------------------*/
+static void USB_Iso_Drop(void);
+static void USB_Iso_Slice(uint16_t len);
+
+/* Private user code ---------------------------------------------------------*/
+
+/**
+  * @brief  Give back a frame not shown yet.
+  * @retval None
+  */
+static void USB_Iso_Drop(void)
+{
+  if (frame != NULL)
+  {
+    USB_Frame_Submit(0U, NULL);
+    frame = NULL;
+  }
+  scheduled = 0U;
+}
+
+/**
+  * @brief  The configuration changed : back to the zero-bandwidth setting.
+  * @param  config: 1 when the host selects the configuration, 0 on reset
+  * @retval None
+  */
+void USB_Iso_Configure(uint8_t config)
+{
+  USB_Iso_SetAlt(0U);
+}
+
+/**
+  * @brief  SET_INTERFACE : open the endpoint in setting 1, close it in 0.
+  * @param  alt: alternate setting
+  * @retval HAL_ERROR for an unknown setting
+  */
+HAL_StatusTypeDef USB_Iso_SetAlt(uint8_t alt)
+{
+  if (alt > 1U)
+  {
+    return HAL_ERROR;
+  }
+
+  USB_Iso_Drop();
+  if (altSetting)
+  {
+    HAL_PCD_EP_Close(&hpcd_USB_FS, USB_ISO_EP);
+  }
+
+  altSetting = alt;
+  if (altSetting)
+  {
+    HAL_PCD_EP_Open(&hpcd_USB_FS, USB_ISO_EP, USB_ISO_EP_SIZE, EP_TYPE_ISOC);
+    HAL_PCD_EP_Receive(&hpcd_USB_FS, USB_ISO_EP, packet, sizeof(packet));
+  }
+
+  return HAL_OK;
+}
+
+/**
+  * @brief  GET_INTERFACE.
+  * @retval Current alternate setting
+  */
+uint8_t USB_Iso_GetAlt(void)
+{
+  return altSetting;
+}
+
+/**
+  * @brief  Store one received slice.
+  * @param  len: packet length
+  * @retval None
+  */
+static void USB_Iso_Slice(uint16_t len)
+{
+  if ((len < USB_ISO_HEADER_SIZE) || scheduled)
+  {
+    return;
+  }
+
+  uint8_t seq = packet[0];
+  uint32_t index = packet[1] & (uint8_t)~USB_ISO_SLICE_LAST;
+
+  /* The last slice of the frame before was lost : show it as it is */
+  if ((frame != NULL) && (seq != frameSeq))
+  {
+    scheduled = 1U;
+    return;
+  }
+
+  if (frame == NULL)
+  {
+    frame = USB_Frame_Acquire();
+    if (frame == NULL)
+    {
+      return;
+    }
+    WS2812_SyncBackBuffer();
+    frameSeq = seq;
+  }
+
+  uint32_t frameBytes = (uint32_t)WS2812_GetLength() * WS2812_GetFormat()->channels;
+  uint32_t offset = index * USB_ISO_SLICE;
+  uint32_t n = len - USB_ISO_HEADER_SIZE;
+
+  if (offset < frameBytes)
+  {
+    if (n > frameBytes - offset)
+    {
+      n = frameBytes - offset;
+    }
+    memcpy(&frame[offset], &packet[USB_ISO_HEADER_SIZE], n);
+  }
+
+  showAt = (packet[2] | ((uint16_t)packet[3] << 8)) & USB_SOF_NUMBER_MASK;
+  if (packet[1] & USB_ISO_SLICE_LAST)
+  {
+    scheduled = 1U;
+  }
+}
+
+/**
+  * @brief  A packet came in, or the frame's slot passed without one.
+  * @param  epnum: endpoint number
+  * @retval None
+  */
+void USB_Iso_DataOut(uint8_t epnum)
+{
+  if ((epnum != (USB_ISO_EP & 0x7FU)) || !altSetting)
+  {
+    return;
+  }
+
+  USB_Iso_Slice((uint16_t)hpcd_USB_FS.OUT_ep[epnum].xfer_count);
+  HAL_PCD_EP_Receive(&hpcd_USB_FS, USB_ISO_EP, packet, sizeof(packet));
+}
+
+/**
+  * @brief  Start of a USB frame : show the waiting frame once its number
+  *         is reached. A frame up to 1 s late is shown at once.
+  * @param  frameNumber: number of the USB frame starting
+  * @retval None
+  */
+void USB_Iso_Sof(uint16_t frameNumber)
+{
+  if (scheduled && USB_Sof_Reached(frameNumber, showAt))
+  {
+    USB_Frame_Submit(1U, NULL);
+    frame = NULL;
+    scheduled = 0U;
+  }
+}
@@ -0,0 +1,89 @@
+/**
+  ******************************************************************************
+  * @file    usb_sof.c
+  * @brief   USB start-of-frame timestamps and SOF-timed presentation.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "usb_sof.h"
+#include "usb_frame.h"
+#include "usb_iso.h"
+#include "clock_trim.h"
+
+/* Private variables ---------------------------------------------------------*/
+static USB_SofStampTypeDef last;
+
+/* Private user code ---------------------------------------------------------*/
+
+/**
+  * @brief  To be called first in the USB interrupt : when it was raised by a
+  *         SOF, stamp it and start the frames waiting for it. The HAL clears
+  *         the flag afterwards.
+  * @retval None
+  */
+void USB_Sof_IrqEntry(void)
+{
+  if ((hpcd_USB_FS.Instance->ISTR & USB_ISTR_SOF) == 0U)
+  {
+    return;
+  }
+
+  /* Stamp first, nothing before it may vary */
+  uint32_t phase = SysTick->LOAD - SysTick->VAL;
+  uint32_t tick = HAL_GetTick();
+
+  /* The SysTick interrupt ranks below USB : its count may lag a reload */
+  if (((SCB->ICSR & SCB_ICSR_PENDSTSET_Msk) != 0U) && (phase < (SysTick->LOAD / 2U)))
+  {
+    tick++;
+  }
+  uint16_t number = (uint16_t)(hpcd_USB_FS.Instance->FNR & USB_FNR_FN);
+
+  last.count += (number - last.count) & USB_SOF_NUMBER_MASK;
+  last.tick = tick;
+  last.phase = phase;
+
+  ClockTrim_Sof(last.count, tick, phase);
+
+  if (USB_Core_IsConfigured())
+  {
+    USB_Frame_Sof(number);
+    USB_Iso_Sof(number);
+  }
+}
+
+/**
+  * @brief  Bus reset : the host restarts its frame numbering.
+  * @retval None
+  */
+void USB_Sof_Reset(void)
+{
+  last.count = 0U;
+}
+
+/**
+  * @brief  Read the last SOF stamp.
+  * @param  stamp: receives the stamp
+  * @retval None
+  */
+void USB_Sof_GetStamp(USB_SofStampTypeDef *stamp)
+{
+  uint32_t primask = __get_PRIMASK();
+
+  __disable_irq();
+  *stamp = last;
+  __set_PRIMASK(primask);
+}
+
+/**
+  * @brief  Tell whether a frame number has been reached. Numbers wrap every
+  *         2048 ms : a target up to 1 s in the past counts as reached.
+  * @param  frameNumber: current frame number
+  * @param  target: frame number waited for
+  * @retval 1 once reached
+  */
+uint8_t USB_Sof_Reached(uint16_t frameNumber, uint16_t target)
+{
+  return ((frameNumber - target) & USB_SOF_NUMBER_MASK) < 0x400U;
+}
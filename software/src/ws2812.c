@@ -0,0 +1,651 @@
+/**
+  ******************************************************************************
+  * @file    ws2812.c
+  * @brief   WS2812 frame side : buffers, levels, frame queue and fences.
+  ******************************************************************************
+  * The bits themselves are produced by the output engine selected with
+  * WS2812_OUTPUT (ws2812_tim17.c, ws2812_bsrr.c, ws2812_dmar.c, ws2812_spi.c),
+  * see ws2812_output.h. This file hands it the front buffer at each frame start
+  * and gets it back once the frame is latched, which is where queued frames
+  * are swapped in. A streamed frame hands it a source to pull from instead.
+  *
+  * Gamma and brightness are merged in a single 256-entry level table giving
+  * an 8.8 fixed-point output, so they cost one extra load per channel whatever
+  * the settings. The table is rebuilt outside the interrupt into a spare copy,
+  * which is switched in at the next frame start. Without dithering only the
+  * integer part is sent. With dithering the fraction left over by each channel
+  * is carried to the same channel of the next frame, and the front buffer is
+  * re-sent after every latch, so the strip averages the 16-bit level over a
+  * few frames.
+  *
+  * WS2812_GetStats() reports the cycles the engine spent encoding, measured
+  * on SysTick.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "ws2812_output.h"
+#include <string.h>
+
+/* Private define ------------------------------------------------------------*/
+#if (WS2812_MAX_CHANNELS != 3U) && (WS2812_MAX_CHANNELS != 4U)
+#error "WS2812_MAX_CHANNELS must be 3 or 4"
+#endif
+
+/* Private variables ---------------------------------------------------------*/
+/* Front buffer is on the wire, back buffer is drawn by the application */
+static uint8_t frames[2][WS2812_FRAME_BYTES];
+static uint8_t *frontBuffer = frames[0];
+static uint8_t *backBuffer = frames[1];
+
+const WS2812_FormatTypeDef WS2812_FormatGRB  = { 3U, { WS2812_G, WS2812_R, WS2812_B, 0U } };
+const WS2812_FormatTypeDef WS2812_FormatRGB  = { 3U, { WS2812_R, WS2812_G, WS2812_B, 0U } };
+const WS2812_FormatTypeDef WS2812_FormatBRG  = { 3U, { WS2812_B, WS2812_R, WS2812_G, 0U } };
+const WS2812_FormatTypeDef WS2812_FormatGRBW = { 4U, { WS2812_G, WS2812_R, WS2812_B, WS2812_W } };
+
+const uint16_t WS2812_Gamma28[256] =
+{
+      0,     0,     0,     0,     1,     1,     2,     3,
+      4,     6,     8,    10,    13,    16,    19,    24,
+     28,    33,    39,    46,    53,    60,    69,    78,
+     88,    98,   110,   122,   135,   149,   164,   179,
+    196,   214,   232,   252,   273,   295,   317,   341,
+    366,   393,   420,   449,   478,   510,   542,   575,
+    610,   647,   684,   723,   764,   806,   849,   894,
+    940,   988,  1037,  1088,  1140,  1194,  1250,  1307,
+   1366,  1427,  1489,  1553,  1619,  1686,  1756,  1827,
+   1900,  1975,  2051,  2130,  2210,  2293,  2377,  2463,
+   2552,  2642,  2734,  2829,  2925,  3024,  3124,  3227,
+   3332,  3439,  3548,  3660,  3774,  3890,  4008,  4128,
+   4251,  4376,  4504,  4634,  4766,  4901,  5038,  5177,
+   5319,  5464,  5611,  5760,  5912,  6067,  6224,  6384,
+   6546,  6711,  6879,  7049,  7222,  7397,  7576,  7757,
+   7941,  8128,  8317,  8509,  8704,  8902,  9103,  9307,
+   9514,  9723,  9936, 10151, 10370, 10591, 10816, 11043,
+  11274, 11507, 11744, 11984, 12227, 12473, 12722, 12975,
+  13230, 13489, 13751, 14017, 14285, 14557, 14833, 15111,
+  15393, 15678, 15967, 16259, 16554, 16853, 17155, 17461,
+  17770, 18083, 18399, 18719, 19042, 19369, 19700, 20034,
+  20372, 20713, 21058, 21407, 21759, 22115, 22475, 22838,
+  23206, 23577, 23952, 24330, 24713, 25099, 25489, 25884,
+  26282, 26683, 27089, 27499, 27913, 28330, 28752, 29178,
+  29608, 30041, 30479, 30921, 31367, 31818, 32272, 32730,
+  33193, 33660, 34131, 34606, 35085, 35569, 36057, 36549,
+  37046, 37547, 38052, 38561, 39075, 39593, 40116, 40643,
+  41175, 41711, 42251, 42796, 43346, 43899, 44458, 45021,
+  45588, 46161, 46737, 47319, 47905, 48495, 49091, 49691,
+  50295, 50905, 51519, 52138, 52761, 53390, 54023, 54661,
+  55303, 55951, 56604, 57261, 57923, 58590, 59262, 59939,
+  60621, 61308, 62000, 62697, 63399, 64106, 64818, 65535,
+};
+
+/* Gamma then brightness, per channel value, 8.8 fixed point capped to 0xFF00
+   so that adding a dithering residue never overflows 8 bits ; one copy in
+   use, one spare */
+static uint16_t levelLut[2][256];
+static volatile uint8_t levelActive;
+static volatile uint8_t levelDirty;
+static const uint16_t *gammaTable;
+static uint8_t brightness = 255U;
+
+/* Fraction not yet shown, per frame buffer byte */
+static uint8_t residue[WS2812_FRAME_BYTES];
+static volatile uint8_t dither;
+static uint8_t repeating;
+
+static const WS2812_FormatTypeDef *format = &WS2812_FormatGRB;
+static uint16_t stripLength = WS2812_PIXELS;
+static WS2812_OutputFrameTypeDef output;
+static volatile uint8_t busy;
+static volatile uint8_t pending;
+static volatile uint32_t framesPresented;
+static volatile uint32_t framesDone;
+#if (WS2812_STATS != 0)
+static WS2812_StatsTypeDef stats;
+#endif
+
+/* Private function prototypes -----------------------------------------------*/
+static HAL_StatusTypeDef WS2812_StartFrame(uint8_t repeat);
+static void WS2812_Swap(void);
+static void WS2812_BuildLevels(void);
+
+/* Private user code ---------------------------------------------------------*/
+
+/**
+  * @brief  Exchange the front and back buffers.
+  * @retval None
+  */
+static void WS2812_Swap(void)
+{
+  uint8_t *tmp = frontBuffer;
+
+  frontBuffer = backBuffer;
+  backBuffer = tmp;
+}
+
+/**
+  * @brief  Hand the front buffer to the output engine.
+  * @param  repeat: 1 if the front buffer was already sent (dithering)
+  * @retval HAL status
+  */
+static HAL_StatusTypeDef WS2812_StartFrame(uint8_t repeat)
+{
+  /* New gamma / brightness apply from a frame boundary */
+  if (levelDirty)
+  {
+    levelActive ^= 1U;
+    levelDirty = 0U;
+  }
+
+  output.pixels = frontBuffer;
+  output.residue = residue;
+  output.level = levelLut[levelActive];
+  output.order = format->order;
+  output.length = stripLength;
+  output.channels = format->channels;
+  output.dither = dither;
+  output.fetch = NULL;
+  repeating = repeat;
+  busy = 1U;
+
+  if (WS2812_Output_Start(&output) != HAL_OK)
+  {
+    /* Drop the frame rather than leave its fence pending forever */
+    busy = 0U;
+    if (!repeat)
+    {
+      framesDone++;
+    }
+    return HAL_ERROR;
+  }
+  return HAL_OK;
+}
+
+/**
+  * @brief  Called by the output engine once the frame is sent and latched.
+  * @retval None
+  */
+void WS2812_Output_Done(void)
+{
+  busy = 0U;
+
+  /* A repeat of the front buffer is not a new frame for the application */
+  uint8_t presented = !repeating;
+  if (presented)
+  {
+    framesDone++;
+  }
+
+  /* Latch boundary : the queued frame goes out right away, or the current
+     one again to carry on dithering */
+  if (pending)
+  {
+    WS2812_Swap();
+    pending = 0U;
+    WS2812_StartFrame(0U);
+  }
+  else if (dither)
+  {
+    WS2812_StartFrame(1U);
+  }
+
+  if (presented)
+  {
+    WS2812_FrameDoneCallback();
+  }
+}
+
+/**
+  * @brief  Called by the output engine after encoding a part of the frame.
+  * @param  cycles: CPU cycles spent
+  * @param  pixels: pixels encoded
+  * @retval None
+  */
+void WS2812_Output_Account(uint32_t cycles, uint32_t pixels)
+{
+#if (WS2812_STATS != 0)
+  stats.cycles += cycles;
+  stats.pixels += pixels;
+#endif
+}
+
+/**
+  * @brief  Set up the output engine, once the peripherals are initialised.
+  * @retval None
+  */
+void WS2812_Init(void)
+{
+  WS2812_Output_Init();
+  WS2812_BuildLevels();
+}
+
+/**
+  * @brief  Fill the spare level table from the gamma curve and brightness.
+  * @retval None
+  */
+static void WS2812_BuildLevels(void)
+{
+  /* No switch can happen while the spare copy is rewritten */
+  levelDirty = 0U;
+
+  uint16_t *level = levelLut[levelActive ^ 1U];
+  uint32_t scale = brightness + 1U;
+
+  for (uint32_t i = 0; i < 256U; i++)
+  {
+    uint32_t value = (gammaTable != NULL) ? gammaTable[i] : i * 257U;
+
+    value = (value * scale) >> 8;
+    level[i] = (value > 0xFF00U) ? 0xFF00U : (uint16_t)value;
+  }
+
+  levelDirty = 1U;
+}
+
+/**
+  * @brief  Select the gamma curve applied to every channel.
+  * @param  table: 256 output levels on 16 bits, e.g. WS2812_Gamma28,
+  *         or NULL for linear
+  * @retval None
+  */
+void WS2812_SetGamma(const uint16_t *table)
+{
+  gammaTable = table;
+  WS2812_BuildLevels();
+}
+
+/**
+  * @brief  Set the global brightness, applied after the gamma curve.
+  * @param  level: 0 (off) to 255 (full)
+  * @retval None
+  */
+void WS2812_SetBrightness(uint8_t level)
+{
+  brightness = level;
+  WS2812_BuildLevels();
+}
+
+/**
+  * @brief  Get the global brightness.
+  * @retval Brightness, 255 being full
+  */
+uint8_t WS2812_GetBrightness(void)
+{
+  return brightness;
+}
+
+/**
+  * @brief  Turn temporal dithering on or off. When on, the front buffer is
+  *         re-sent after each latch, as fast as the strip length allows,
+  *         until dithering is turned off ; WS2812_IsBusy() stays set.
+  * @param  enable: 1 to dither
+  * @retval None
+  */
+void WS2812_SetDither(uint8_t enable)
+{
+  uint32_t primask = __get_PRIMASK();
+
+  /* No engine reads the residue while dithering is off : clear it with the
+     interrupts on, the ring refills of a frame on the wire cannot wait */
+  if (enable && !dither)
+  {
+    memset(residue, 0, sizeof(residue));
+  }
+
+  __disable_irq();
+  if (enable && !dither)
+  {
+    dither = 1U;
+
+    /* Idle strip : start repeating what was last shown */
+    if (!busy)
+    {
+      WS2812_StartFrame(1U);
+    }
+  }
+  else if (!enable)
+  {
+    dither = 0U;
+  }
+  __set_PRIMASK(primask);
+}
+
+/**
+  * @brief  Tell whether temporal dithering is on.
+  * @retval 1 while the front buffer is re-sent after each latch
+  */
+uint8_t WS2812_GetDither(void)
+{
+  return dither;
+}
+
+/**
+  * @brief  Select the pixel format of the strip. The frame buffer layout
+  *         follows the channel count, so redraw it after a change. The frame
+  *         on the wire keeps its format : the new one applies from the next
+  *         frame start, including the next repeat while dithering.
+  * @param  fmt: WS2812_FormatGRB, WS2812_FormatGRBW, ...
+  * @retval HAL_ERROR if the strip would not fit, HAL_BUSY while a frame is queued
+  */
+HAL_StatusTypeDef WS2812_SetFormat(const WS2812_FormatTypeDef *fmt)
+{
+  if ((fmt->channels < 3U) || (fmt->channels > WS2812_MAX_CHANNELS) ||
+      ((uint32_t)stripLength * fmt->channels > WS2812_FRAME_BYTES))
+  {
+    return HAL_ERROR;
+  }
+  /* The queued frame was drawn for the current layout ; the one on the
+     wire has its length and format copied at its start */
+  if (pending)
+  {
+    return HAL_BUSY;
+  }
+
+  format = fmt;
+  return HAL_OK;
+}
+
+/**
+  * @brief  Get the pixel format of the strip.
+  * @retval Current format
+  */
+const WS2812_FormatTypeDef *WS2812_GetFormat(void)
+{
+  return format;
+}
+
+/**
+  * @brief  Set the number of pixels actually chained on the output. Applies
+  *         from the next frame start, as WS2812_SetFormat().
+  * @param  pixels: strip length, up to WS2812_FRAME_BYTES / channels
+  * @retval HAL_ERROR if too long, HAL_BUSY while a frame is queued
+  */
+HAL_StatusTypeDef WS2812_SetLength(uint16_t pixels)
+{
+  if ((uint32_t)pixels * format->channels > WS2812_FRAME_BYTES)
+  {
+    return HAL_ERROR;
+  }
+  if (pending)
+  {
+    return HAL_BUSY;
+  }
+
+  stripLength = pixels;
+  return HAL_OK;
+}
+
+/**
+  * @brief  Get the number of pixels sent by WS2812_Present().
+  * @retval Strip length
+  */
+uint16_t WS2812_GetLength(void)
+{
+  return stripLength;
+}
+
+/**
+  * @brief  Set the colour of one pixel of the back buffer, white off.
+  *         Out of range indexes are ignored.
+  * @param  index: pixel position on the strip
+  * @param  red, green, blue: colour
+  * @retval None
+  */
+void WS2812_SetPixel(uint16_t index, uint8_t red, uint8_t green, uint8_t blue)
+{
+  WS2812_SetPixelRGBW(index, red, green, blue, 0U);
+}
+
+/**
+  * @brief  Set the colour of one pixel of the back buffer.
+  *         White is dropped on 3-channel strips.
+  * @param  index: pixel position on the strip
+  * @param  red, green, blue, white: colour
+  * @retval None
+  */
+void WS2812_SetPixelRGBW(uint16_t index, uint8_t red, uint8_t green, uint8_t blue, uint8_t white)
+{
+  if (index >= stripLength)
+  {
+    return;
+  }
+
+  uint8_t *px = &backBuffer[format->channels * index];
+  px[WS2812_R] = red;
+  px[WS2812_G] = green;
+  px[WS2812_B] = blue;
+  if (format->channels > 3U)
+  {
+    px[WS2812_W] = white;
+  }
+}
+
+/**
+  * @brief  Set every pixel of the strip to the same colour, white off.
+  * @param  red, green, blue: colour
+  * @retval None
+  */
+void WS2812_Fill(uint8_t red, uint8_t green, uint8_t blue)
+{
+  WS2812_FillRGBW(red, green, blue, 0U);
+}
+
+/**
+  * @brief  Set every pixel of the strip to the same colour.
+  * @param  red, green, blue, white: colour
+  * @retval None
+  */
+void WS2812_FillRGBW(uint8_t red, uint8_t green, uint8_t blue, uint8_t white)
+{
+  for (uint16_t i = 0; i < stripLength; i++)
+  {
+    WS2812_SetPixelRGBW(i, red, green, blue, white);
+  }
+}
+
+/**
+  * @brief  Get the buffer to draw the next frame into (R, G, B[, W] per pixel).
+  *         Only write it while WS2812_CanRender() is true.
+  * @retval Back buffer
+  */
+uint8_t *WS2812_GetBackBuffer(void)
+{
+  return backBuffer;
+}
+
+/**
+  * @brief  Copy the frame last presented into the back buffer, so that the
+  *         next frame can be an update of part of it.
+  *         Only call it while WS2812_CanRender() is true.
+  * @retval None
+  */
+void WS2812_SyncBackBuffer(void)
+{
+  memcpy(backBuffer, frontBuffer, (uint32_t)stripLength * format->channels);
+}
+
+/**
+  * @brief  Tell whether the back buffer is free, i.e. not queued for display.
+  * @retval 1 if the application may draw
+  */
+uint8_t WS2812_CanRender(void)
+{
+  return !pending;
+}
+
+/**
+  * @brief  Queue the back buffer for display. It goes out at once if the
+  *         strip is idle, else at the end of the current frame's latch.
+  *         The whole strip is sent in a single DMA run, then latched.
+  * @param  fence: if not NULL, receives the fence of the queued frame
+  * @retval HAL_BUSY if a frame is already queued
+  */
+HAL_StatusTypeDef WS2812_Present(uint32_t *fence)
+{
+  HAL_StatusTypeDef status = HAL_OK;
+  uint32_t primask = __get_PRIMASK();
+
+  __disable_irq();
+  if (pending)
+  {
+    status = HAL_BUSY;
+  }
+  else
+  {
+    framesPresented++;
+    if (fence != NULL)
+    {
+      *fence = framesPresented;
+    }
+
+    if (busy)
+    {
+      pending = 1U;
+    }
+    else
+    {
+      WS2812_Swap();
+      status = WS2812_StartFrame(0U);
+    }
+  }
+  __set_PRIMASK(primask);
+
+  return status;
+}
+
+/**
+  * @brief  Send a frame pulled from a source while it is on the wire, instead
+  *         of from the back buffer. The strip must be idle, with no frame
+  *         queued and dithering off. The current format and levels apply.
+  * @param  pixels: length of the chain, may exceed WS2812_PIXELS
+  * @param  fetch: source of the frame bytes, see WS2812_FetchTypeDef
+  * @param  fence: if not NULL, receives the fence of the frame
+  * @retval HAL_ERROR on a parallel engine, HAL_BUSY unless idle
+  */
+HAL_StatusTypeDef WS2812_PresentStream(uint16_t pixels, WS2812_FetchTypeDef fetch, uint32_t *fence)
+{
+  HAL_StatusTypeDef status;
+  uint32_t primask = __get_PRIMASK();
+
+  if (WS2812_OUTPUTS != 1U)
+  {
+    return HAL_ERROR;
+  }
+
+  __disable_irq();
+  if (busy || pending || dither)
+  {
+    status = HAL_BUSY;
+  }
+  else
+  {
+    framesPresented++;
+    if (fence != NULL)
+    {
+      *fence = framesPresented;
+    }
+
+    if (levelDirty)
+    {
+      levelActive ^= 1U;
+      levelDirty = 0U;
+    }
+
+    output.pixels = NULL;
+    output.residue = NULL;
+    output.level = levelLut[levelActive];
+    output.order = format->order;
+    output.length = pixels;
+    output.channels = format->channels;
+    output.dither = 0U;
+    output.fetch = fetch;
+    repeating = 0U;
+    busy = 1U;
+
+    status = WS2812_Output_Start(&output);
+    if (status != HAL_OK)
+    {
+      busy = 0U;
+      framesDone++;
+    }
+  }
+  __set_PRIMASK(primask);
+
+  return status;
+}
+
+/**
+  * @brief  Tell whether a presented frame has been sent and latched.
+  * @param  fence: value returned by WS2812_Present()
+  * @retval 1 once the frame is done
+  */
+uint8_t WS2812_FenceReached(uint32_t fence)
+{
+  return (int32_t)(framesDone - fence) >= 0;
+}
+
+/**
+  * @brief  Count of frames sent and latched so far. The fence of a frame is
+  *         reached once this count gets to it.
+  * @retval Frames done
+  */
+uint32_t WS2812_GetFramesDone(void)
+{
+  return framesDone;
+}
+
+/**
+  * @brief  Wait until a presented frame has been sent and latched.
+  * @param  fence: value returned by WS2812_Present()
+  * @retval None
+  */
+void WS2812_WaitFence(uint32_t fence)
+{
+  while (!WS2812_FenceReached(fence))
+  {
+  }
+}
+
+/**
+  * @brief  Tell whether a frame is still being sent.
+  * @retval 1 until the latch after the last pixel has elapsed
+  */
+uint8_t WS2812_IsBusy(void)
+{
+  return busy;
+}
+
+/**
+  * @brief  Read the encoder CPU load counters.
+  *         All zero when built with WS2812_STATS set to 0.
+  * @param  out: receives the counters
+  * @param  reset: clear the counters after reading
+  * @retval None
+  */
+void WS2812_GetStats(WS2812_StatsTypeDef *out, uint8_t reset)
+{
+#if (WS2812_STATS != 0)
+  uint32_t primask = __get_PRIMASK();
+
+  __disable_irq();
+  *out = stats;
+  if (reset)
+  {
+    stats.cycles = 0U;
+    stats.pixels = 0U;
+  }
+  __set_PRIMASK(primask);
+#else
+  out->cycles = 0U;
+  out->pixels = 0U;
+#endif
+}
+
+/**
+  * @brief  Frame and latch are done, the next frame can be shown.
+  * @note   Called from the output engine interrupt, to be overridden by the user.
+  * @retval None
+  */
+__weak void WS2812_FrameDoneCallback(void)
+{
+}
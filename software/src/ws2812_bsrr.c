@@ -0,0 +1,349 @@
+/**
+  ******************************************************************************
+  * @file    ws2812_bsrr.c
+  * @brief   WS2812 output engine : WS2812_BSRR_STRIPS strips in parallel on
+  *          one GPIO port, TIM2 + DMA1 Channels 2, 3 and 5.
+  ******************************************************************************
+  * TIM2 counts one bit period and raises three DMA requests per bit :
+  *
+  *   update (Channel 2)  writes the strip mask to BSRR : every line goes high
+  *   CC1 at T0H (Ch 5)   writes the next ring halfword to BRR : the lines
+  *                       sending a 0 go low
+  *   CC2 at T1H (Ch 3)   writes the strip mask to BRR : every line is low
+  *
+  * Channel 2 runs in normal mode for exactly the number of bits of a strip,
+  * so the lines stay low once the data is out. Channel 5 walks a circular
+  * ring of halfwords split in two halves ; its half-transfer and
+  * transfer-complete interrupts re-encode the half just sent, as on TIM17,
+  * and keep counting halves through the latch, after which everything is
+  * stopped and the frame is handed back.
+  *
+  * The chain of the frame buffer is split evenly : with L pixels, strip s
+  * sends pixels s * P to (s + 1) * P - 1, P = L / WS2812_BSRR_STRIPS rounded
+  * up. Pixels past the end of the chain are sent black. A frame thus takes
+  * the time of P pixels instead of L.
+  *
+  * Each ring halfword holds one bit of every strip, so the encoder gathers
+  * the output byte of each strip then transposes 8 strips at a time with
+  * WS2812_Transpose8x8() (ws2812_transpose.h). The transpose and the 8
+  * stores take about 60 cycles per group ; gathering the bytes through the
+  * level table about 8 cycles per strip. At 8 strips a pixel position costs
+  * roughly 400 cycles against 1440 on the wire, i.e. about 50 cycles per
+  * pixel : "neopixel_usb.py bench" reports the measured figure.
+  *
+  * The three DMA channels are given the highest priority : the CC1 write
+  * must land between the two others, i.e. within T1H - T0H of the match.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "ws2812_output.h"
+
+#if (WS2812_OUTPUT == WS2812_OUTPUT_BSRR)
+
+#include "ws2812_transpose.h"
+#include "cycle_count.h"
+
+/* Private define ------------------------------------------------------------*/
+#if (WS2812_BSRR_STRIPS < 1U) || (WS2812_BSRR_PIN0 + WS2812_BSRR_STRIPS > 16U)
+#error "WS2812_BSRR_STRIPS pins do not fit in the port"
+#endif
+
+#define WS2812_BSRR_MASK        ((((1UL << WS2812_BSRR_STRIPS) - 1UL) << WS2812_BSRR_PIN0) & 0xFFFFUL)
+
+/* Latch in bit periods, counted in ring halves once the data is out, plus
+   one half for the event that ends the data coming before its last bit */
+#define WS2812_LATCH_PERIODS    ((WS2812_LATCH_US * WS2812_TIMER_MHZ + WS2812_BIT_TICKS - 1U) / WS2812_BIT_TICKS)
+
+#define WS2812_DMA_PRIORITY     (DMA_CCR_PL_1 | DMA_CCR_PL_0)
+
+/* Transpose groups of 8 strips, and the port word of a group's bits */
+#define WS2812_BSRR_GROUPS      ((WS2812_BSRR_STRIPS + 7U) / 8U)
+#define WS2812_BRR(bits)        ((uint16_t)(((bits) << WS2812_BSRR_PIN0) & WS2812_BSRR_MASK))
+
+/* Private variables ---------------------------------------------------------*/
+/* Constant sources of the set-all and clear-all transfers */
+static const uint32_t stripMask = WS2812_BSRR_MASK;
+
+/* One halfword per bit : the lines to pull low at T0H */
+static uint16_t ring[WS2812_OUTPUT_RING_BYTES / 2U];
+static const WS2812_OutputFrameTypeDef *frame;
+static uint32_t halfSlots;
+static uint32_t stripPixels;
+static uint32_t dataHalves;
+static uint32_t lastHalf;
+static volatile uint32_t halvesDone;
+
+/* Private function prototypes -----------------------------------------------*/
+static void WS2812_EncodeBits(uint16_t *dst, const uint32_t *value);
+static uint32_t WS2812_FillHalf(uint16_t *dst, uint32_t seq);
+static void WS2812_Refill(uint16_t *half);
+static void WS2812_Stop(void);
+
+/* Private user code ---------------------------------------------------------*/
+
+/**
+  * @brief  Turn one byte per strip into the 8 BRR words of these bits.
+  * @param  dst: first of the 8 ring slots to write
+  * @param  value: output byte of each strip, 8 per group, unused ones 0
+  * @retval None
+  */
+static void WS2812_EncodeBits(uint16_t *dst, const uint32_t *value)
+{
+  /* BRR takes the lines sending a 0 : transpose the complement */
+  uint32_t x = ~value[1];
+  uint32_t y = ~value[0];
+
+  WS2812_Transpose8x8(&x, &y);
+
+#if (WS2812_BSRR_GROUPS == 1U)
+  dst[0] = WS2812_BRR(x >> 24);
+  dst[1] = WS2812_BRR((x >> 16) & 0xFFU);
+  dst[2] = WS2812_BRR((x >> 8) & 0xFFU);
+  dst[3] = WS2812_BRR(x & 0xFFU);
+  dst[4] = WS2812_BRR(y >> 24);
+  dst[5] = WS2812_BRR((y >> 16) & 0xFFU);
+  dst[6] = WS2812_BRR((y >> 8) & 0xFFU);
+  dst[7] = WS2812_BRR(y & 0xFFU);
+#else
+  /* Strips 8..15 give the high byte of each word */
+  uint32_t u = ~value[3];
+  uint32_t v = ~value[2];
+
+  WS2812_Transpose8x8(&u, &v);
+
+  dst[0] = WS2812_BRR((x >> 24) | ((u >> 16) & 0xFF00U));
+  dst[1] = WS2812_BRR(((x >> 16) & 0xFFU) | ((u >> 8) & 0xFF00U));
+  dst[2] = WS2812_BRR(((x >> 8) & 0xFFU) | (u & 0xFF00U));
+  dst[3] = WS2812_BRR((x & 0xFFU) | ((u << 8) & 0xFF00U));
+  dst[4] = WS2812_BRR((y >> 24) | ((v >> 16) & 0xFF00U));
+  dst[5] = WS2812_BRR(((y >> 16) & 0xFFU) | ((v >> 8) & 0xFF00U));
+  dst[6] = WS2812_BRR(((y >> 8) & 0xFFU) | (v & 0xFF00U));
+  dst[7] = WS2812_BRR((y & 0xFFU) | ((v << 8) & 0xFF00U));
+#endif
+}
+
+/**
+  * @brief  Encode the seq-th half of the frame into a ring half.
+  *         Halves past the last pixel are left idle (latch).
+  * @param  dst: ring half to fill
+  * @param  seq: index of the half in the frame
+  * @retval Number of pixels encoded, over all strips
+  */
+static uint32_t WS2812_FillHalf(uint16_t *dst, uint32_t seq)
+{
+  uint16_t *end = dst + halfSlots;
+  uint32_t count = 0U;
+
+  if (seq < dataHalves)
+  {
+    const uint32_t channels = frame->channels;
+    const uint32_t stride = stripPixels * channels;
+    const uint32_t limit = (uint32_t)frame->length * channels;
+    const uint16_t *level = frame->level;
+    const uint8_t *pixels = frame->pixels;
+    uint32_t first = seq * WS2812_RING_PIXELS;
+    uint32_t value[2U * WS2812_BSRR_GROUPS] = { 0U };
+    uint8_t *bytes = (uint8_t *)value;
+
+    count = stripPixels - first;
+    if (count > WS2812_RING_PIXELS)
+    {
+      count = WS2812_RING_PIXELS;
+    }
+
+    for (uint32_t p = first; p < first + count; p++)
+    {
+      for (uint32_t c = 0; c < channels; c++)
+      {
+        /* Same byte of the same pixel position on every strip */
+        uint32_t index = p * channels + frame->order[c];
+
+        for (uint32_t s = 0; s < WS2812_BSRR_STRIPS; s++)
+        {
+          if (index >= limit)
+          {
+            bytes[s] = 0U;
+          }
+          else if (frame->dither)
+          {
+            bytes[s] = WS2812_Output_Level(frame, index);
+          }
+          else
+          {
+            bytes[s] = (uint8_t)(level[pixels[index]] >> 8);
+          }
+          index += stride;
+        }
+        WS2812_EncodeBits(dst, value);
+        dst += 8;
+      }
+    }
+    count = WS2812_Output_Pixels(frame, stripPixels, WS2812_BSRR_STRIPS, first, count);
+  }
+
+  while (dst < end)
+  {
+    *dst++ = 0U;
+  }
+
+  return count;
+}
+
+/**
+  * @brief  Called once a ring half has been clocked out.
+  * @param  half: the ring half that just finished
+  * @retval None
+  */
+static void WS2812_Refill(uint16_t *half)
+{
+  halvesDone++;
+
+  if (halvesDone >= lastHalf)
+  {
+    WS2812_Stop();
+    WS2812_Output_Done();
+    return;
+  }
+
+  /* The other half is playing : this one carries the half after it */
+#if (WS2812_STATS != 0)
+  uint32_t start = CycleCount_Now();
+  uint32_t pixels = WS2812_FillHalf(half, halvesDone + 1U);
+  WS2812_Output_Account(CycleCount_Since(start), pixels);
+#else
+  WS2812_FillHalf(half, halvesDone + 1U);
+#endif
+}
+
+/**
+  * @brief  Stop TIM2 and the three DMA channels, the lines are low.
+  * @retval None
+  */
+static void WS2812_Stop(void)
+{
+  TIM2->CR1 &= ~TIM_CR1_CEN;
+  TIM2->DIER = 0U;
+
+  DMA1_Channel2->CCR &= ~DMA_CCR_EN;
+  DMA1_Channel3->CCR &= ~DMA_CCR_EN;
+  DMA1_Channel5->CCR &= ~DMA_CCR_EN;
+  DMA1->IFCR = DMA_IFCR_CGIF2 | DMA_IFCR_CGIF3 | DMA_IFCR_CGIF5;
+
+  WS2812_BSRR_PORT->BRR = WS2812_BSRR_MASK;
+}
+
+/**
+  * @brief  Set up the strip pins, TIM2 and the DMA channels.
+  * @retval None
+  */
+void WS2812_Output_Init(void)
+{
+  GPIO_InitTypeDef GPIO_InitStruct = {0};
+
+  /* Profile ticks assume this timer clock */
+  if (HAL_RCC_GetPCLK1Freq() != WS2812_TIMER_MHZ * 1000000U)
+  {
+    Error_Handler();
+  }
+
+  WS2812_BSRR_PORT_CLK_ENABLE();
+  WS2812_BSRR_PORT->BRR = WS2812_BSRR_MASK;
+  GPIO_InitStruct.Pin = WS2812_BSRR_MASK;
+  GPIO_InitStruct.Mode = GPIO_MODE_OUTPUT_PP;
+  GPIO_InitStruct.Pull = GPIO_NOPULL;
+  GPIO_InitStruct.Speed = GPIO_SPEED_FREQ_HIGH;
+  HAL_GPIO_Init(WS2812_BSRR_PORT, &GPIO_InitStruct);
+
+  __HAL_RCC_TIM2_CLK_ENABLE();
+  __HAL_RCC_DMA1_CLK_ENABLE();
+
+  /* Frozen compare channels : they only time the DMA requests */
+  TIM2->CR1 = 0U;
+  TIM2->PSC = 0U;
+  TIM2->ARR = WS2812_BIT_TICKS - 1U;
+  TIM2->CCR1 = WS2812_T0H_TICKS;
+  TIM2->CCR2 = WS2812_T1H_TICKS;
+  TIM2->CCMR1 = 0U;
+  TIM2->EGR = TIM_EGR_UG;
+  TIM2->SR = 0U;
+
+  DMA1_Channel2->CPAR = (uint32_t)&WS2812_BSRR_PORT->BSRR;
+  DMA1_Channel3->CPAR = (uint32_t)&WS2812_BSRR_PORT->BRR;
+  DMA1_Channel5->CPAR = (uint32_t)&WS2812_BSRR_PORT->BRR;
+
+  HAL_NVIC_SetPriority(DMA1_Channel4_5_6_7_IRQn, 0, 0);
+  HAL_NVIC_EnableIRQ(DMA1_Channel4_5_6_7_IRQn);
+}
+
+/**
+  * @brief  Start streaming a frame.
+  * @param  out: frame to send
+  * @retval HAL_ERROR if a strip has more bits than a DMA run
+  */
+HAL_StatusTypeDef WS2812_Output_Start(const WS2812_OutputFrameTypeDef *out)
+{
+  uint32_t bits;
+
+  frame = out;
+  halfSlots = WS2812_RING_PIXELS * 8U * out->channels;
+  stripPixels = (out->length + WS2812_BSRR_STRIPS - 1U) / WS2812_BSRR_STRIPS;
+  bits = stripPixels * 8U * out->channels;
+  if ((bits == 0U) || (bits > 0xFFFFU))
+  {
+    return HAL_ERROR;
+  }
+
+  dataHalves = (stripPixels + WS2812_RING_PIXELS - 1U) / WS2812_RING_PIXELS;
+  lastHalf = dataHalves + (WS2812_LATCH_PERIODS + halfSlots - 1U) / halfSlots + 1U;
+  halvesDone = 0U;
+  WS2812_FillHalf(&ring[0], 0U);
+  WS2812_FillHalf(&ring[halfSlots], 1U);
+
+  DMA1_Channel2->CMAR = (uint32_t)&stripMask;
+  DMA1_Channel2->CNDTR = bits;
+  DMA1_Channel2->CCR = WS2812_DMA_PRIORITY | DMA_CCR_MSIZE_1 | DMA_CCR_PSIZE_1 |
+                       DMA_CCR_DIR | DMA_CCR_EN;
+
+  DMA1_Channel3->CMAR = (uint32_t)&stripMask;
+  DMA1_Channel3->CNDTR = 1U;
+  DMA1_Channel3->CCR = WS2812_DMA_PRIORITY | DMA_CCR_MSIZE_1 | DMA_CCR_PSIZE_1 |
+                       DMA_CCR_CIRC | DMA_CCR_DIR | DMA_CCR_EN;
+
+  DMA1_Channel5->CMAR = (uint32_t)ring;
+  DMA1_Channel5->CNDTR = 2U * halfSlots;
+  DMA1_Channel5->CCR = WS2812_DMA_PRIORITY | DMA_CCR_MSIZE_0 | DMA_CCR_PSIZE_0 |
+                       DMA_CCR_MINC | DMA_CCR_CIRC | DMA_CCR_DIR |
+                       DMA_CCR_HTIE | DMA_CCR_TCIE | DMA_CCR_EN;
+
+  /* The first tick wraps the counter : the first request is the update */
+  TIM2->SR = 0U;
+  TIM2->CNT = WS2812_BIT_TICKS - 1U;
+  TIM2->DIER = TIM_DIER_UDE | TIM_DIER_CC1DE | TIM_DIER_CC2DE;
+  TIM2->CR1 |= TIM_CR1_CEN;
+
+  return HAL_OK;
+}
+
+/**
+  * @brief  DMA1 Channel 5 interrupt : a ring half has been sent.
+  * @retval None
+  */
+void WS2812_Bsrr_IRQHandler(void)
+{
+  uint32_t isr = DMA1->ISR;
+
+  /* One half per entry : the frame may end, and the next one start, here */
+  if (isr & DMA_ISR_HTIF5)
+  {
+    DMA1->IFCR = DMA_IFCR_CHTIF5;
+    WS2812_Refill(&ring[0]);
+  }
+  else if (isr & DMA_ISR_TCIF5)
+  {
+    DMA1->IFCR = DMA_IFCR_CTCIF5;
+    WS2812_Refill(&ring[halfSlots]);
+  }
+}
+
+#endif /* WS2812_OUTPUT == WS2812_OUTPUT_BSRR */
@@ -0,0 +1,292 @@
+/**
+  ******************************************************************************
+  * @file    ws2812_dmar.c
+  * @brief   WS2812 output engine : 4 strips on TIM3 CH1..CH4, one DMA burst
+  *          through TIM3->DMAR per bit (DMA1 Channel 3).
+  ******************************************************************************
+  * This is the TIM17 PWM scheme on a 4-channel timer. Every update event
+  * starts a 4-transfer burst through DMAR, DBA = CCR1, which writes the next
+  * compare value of each of the four strips. The compare registers are
+  * preloaded, so the values take effect together at the following update :
+  * the edges come from the timer outputs, with no GPIO or DMA jitter.
+  *
+  * The ring holds one 32-bit word per bit, one compare byte per strip, read
+  * by the DMA as bytes and zero-extended into the halfword CCRs. It is split
+  * in two halves refilled on the half-transfer / transfer-complete
+  * interrupts, as on TIM17. Once the data is out the ring holds zero duty,
+  * so the outputs stay low while the latch is counted in ring halves.
+  *
+  * The chain of the frame buffer is split evenly over the four strips as by
+  * the BSRR engine (see ws2812_bsrr.c), so a frame takes a quarter of the
+  * single-strip time.
+  *
+  * Encoding four strips at once is cheap : the output bytes of the strips
+  * form one word, and each bit is (word >> (7 - k)) & 0x01010101 scaled from
+  * T0H to T1H in a single multiply-add, i.e. one word store per bit for four
+  * strips. About 6 cycles per bit, so roughly 20 cycles per RGB pixel plus
+  * the level lookups.
+  *
+  * Pins : PA6, PA7, PB0, PB1 (AF1). TIM1 has the same four channels but its
+  * CH4 is on PA11, taken by USB, so a second timer is not offered.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "ws2812_output.h"
+
+#if (WS2812_OUTPUT == WS2812_OUTPUT_DMAR)
+
+#include "cycle_count.h"
+
+/* Private define ------------------------------------------------------------*/
+#define WS2812_DMAR_STRIPS      4U
+
+/* Latch in bit periods, counted in ring halves once the data is out, plus
+   one half for the leading idle bit and the preload delay */
+#define WS2812_LATCH_PERIODS    ((WS2812_LATCH_US * WS2812_TIMER_MHZ + WS2812_BIT_TICKS - 1U) / WS2812_BIT_TICKS)
+
+/* Compare bytes of four strips for a word of 0 / 1 bits */
+#define WS2812_ZERO_WORD        (WS2812_T0H_TICKS * 0x01010101UL)
+#define WS2812_ONE_STEP         (WS2812_T1H_TICKS - WS2812_T0H_TICKS)
+#define WS2812_BITS(value, k)   (WS2812_ZERO_WORD + (((value) >> (7U - (k))) & 0x01010101UL) * WS2812_ONE_STEP)
+
+#if (WS2812_BIT_TICKS > 256U)
+#error "Bit period too long for the byte-wide DMA ring"
+#endif
+
+/* Private variables ---------------------------------------------------------*/
+/* One word per bit, strip s in byte s */
+static uint32_t ring[WS2812_OUTPUT_RING_BYTES / 4U];
+static const WS2812_OutputFrameTypeDef *frame;
+static uint32_t halfSlots;
+static uint32_t stripPixels;
+static uint32_t dataHalves;
+static uint32_t lastHalf;
+static volatile uint32_t halvesDone;
+
+/* Private function prototypes -----------------------------------------------*/
+static uint32_t WS2812_FillHalf(uint32_t *dst, uint32_t seq);
+static void WS2812_Refill(uint32_t *half);
+static void WS2812_Stop(void);
+
+/* Private user code ---------------------------------------------------------*/
+
+/**
+  * @brief  Encode the seq-th half of the frame into a ring half.
+  *         Halves past the last pixel are filled with zero duty (latch).
+  * @param  dst: ring half to fill
+  * @param  seq: index of the half in the frame
+  * @retval Number of pixels encoded, over all strips
+  */
+static uint32_t WS2812_FillHalf(uint32_t *dst, uint32_t seq)
+{
+  uint32_t *end = dst + halfSlots;
+  uint32_t count = 0U;
+
+  if (seq < dataHalves)
+  {
+    const uint32_t channels = frame->channels;
+    const uint32_t stride = stripPixels * channels;
+    const uint32_t limit = (uint32_t)frame->length * channels;
+    uint32_t first = seq * WS2812_RING_PIXELS;
+
+    count = stripPixels - first;
+    if (count > WS2812_RING_PIXELS)
+    {
+      count = WS2812_RING_PIXELS;
+    }
+
+    for (uint32_t p = first; p < first + count; p++)
+    {
+      for (uint32_t c = 0; c < channels; c++)
+      {
+        /* Same byte of the same pixel position on every strip */
+        uint32_t index = p * channels + frame->order[c];
+        uint32_t value = 0U;
+
+        for (uint32_t s = 0; s < 8U * WS2812_DMAR_STRIPS; s += 8U)
+        {
+          if (index < limit)
+          {
+            value |= (uint32_t)WS2812_Output_Level(frame, index) << s;
+          }
+          index += stride;
+        }
+
+        dst[0] = WS2812_BITS(value, 0U);
+        dst[1] = WS2812_BITS(value, 1U);
+        dst[2] = WS2812_BITS(value, 2U);
+        dst[3] = WS2812_BITS(value, 3U);
+        dst[4] = WS2812_BITS(value, 4U);
+        dst[5] = WS2812_BITS(value, 5U);
+        dst[6] = WS2812_BITS(value, 6U);
+        dst[7] = WS2812_BITS(value, 7U);
+        dst += 8;
+      }
+    }
+    count = WS2812_Output_Pixels(frame, stripPixels, WS2812_DMAR_STRIPS, first, count);
+  }
+
+  while (dst < end)
+  {
+    *dst++ = 0U;
+  }
+
+  return count;
+}
+
+/**
+  * @brief  Called once a ring half has been clocked out.
+  * @param  half: the ring half that just finished
+  * @retval None
+  */
+static void WS2812_Refill(uint32_t *half)
+{
+  halvesDone++;
+
+  if (halvesDone >= lastHalf)
+  {
+    WS2812_Stop();
+    WS2812_Output_Done();
+    return;
+  }
+
+  /* The other half is playing : this one carries the half after it */
+#if (WS2812_STATS != 0)
+  uint32_t start = CycleCount_Now();
+  uint32_t pixels = WS2812_FillHalf(half, halvesDone + 1U);
+  WS2812_Output_Account(CycleCount_Since(start), pixels);
+#else
+  WS2812_FillHalf(half, halvesDone + 1U);
+#endif
+}
+
+/**
+  * @brief  Stop TIM3 and its DMA channel, the outputs are low.
+  * @retval None
+  */
+static void WS2812_Stop(void)
+{
+  TIM3->CR1 &= ~TIM_CR1_CEN;
+  TIM3->DIER = 0U;
+
+  DMA1_Channel3->CCR &= ~DMA_CCR_EN;
+  DMA1->IFCR = DMA_IFCR_CGIF3;
+
+  TIM3->CCR1 = 0U;
+  TIM3->CCR2 = 0U;
+  TIM3->CCR3 = 0U;
+  TIM3->CCR4 = 0U;
+  TIM3->EGR = TIM_EGR_UG;
+}
+
+/**
+  * @brief  Set up the strip pins, TIM3 and the DMA channel.
+  * @retval None
+  */
+void WS2812_Output_Init(void)
+{
+  GPIO_InitTypeDef GPIO_InitStruct = {0};
+
+  /* Profile ticks assume this timer clock */
+  if (HAL_RCC_GetPCLK1Freq() != WS2812_TIMER_MHZ * 1000000U)
+  {
+    Error_Handler();
+  }
+
+  __HAL_RCC_GPIOA_CLK_ENABLE();
+  __HAL_RCC_GPIOB_CLK_ENABLE();
+  __HAL_RCC_TIM3_CLK_ENABLE();
+  __HAL_RCC_DMA1_CLK_ENABLE();
+
+  /* PWM 1 with preloaded compares : low for the whole bit while CCR is 0 */
+  TIM3->CR1 = TIM_CR1_ARPE;
+  TIM3->PSC = 0U;
+  TIM3->ARR = WS2812_BIT_TICKS - 1U;
+  TIM3->CCMR1 = TIM_OCMODE_PWM1 | TIM_CCMR1_OC1PE | (TIM_OCMODE_PWM1 << 8) | TIM_CCMR1_OC2PE;
+  TIM3->CCMR2 = TIM_OCMODE_PWM1 | TIM_CCMR2_OC3PE | (TIM_OCMODE_PWM1 << 8) | TIM_CCMR2_OC4PE;
+  TIM3->CCER = TIM_CCER_CC1E | TIM_CCER_CC2E | TIM_CCER_CC3E | TIM_CCER_CC4E;
+  TIM3->DCR = TIM_DMABURSTLENGTH_4TRANSFERS | TIM_DMABASE_CCR1;
+  WS2812_Stop();
+
+  /**TIM3 GPIO Configuration
+  PA6     ------> TIM3_CH1
+  PA7     ------> TIM3_CH2
+  PB0     ------> TIM3_CH3
+  PB1     ------> TIM3_CH4
+  */
+  GPIO_InitStruct.Mode = GPIO_MODE_AF_PP;
+  GPIO_InitStruct.Pull = GPIO_NOPULL;
+  GPIO_InitStruct.Speed = GPIO_SPEED_FREQ_HIGH;
+  GPIO_InitStruct.Alternate = GPIO_AF1_TIM3;
+  GPIO_InitStruct.Pin = GPIO_PIN_6 | GPIO_PIN_7;
+  HAL_GPIO_Init(GPIOA, &GPIO_InitStruct);
+  GPIO_InitStruct.Pin = GPIO_PIN_0 | GPIO_PIN_1;
+  HAL_GPIO_Init(GPIOB, &GPIO_InitStruct);
+
+  DMA1_Channel3->CPAR = (uint32_t)&TIM3->DMAR;
+
+  HAL_NVIC_SetPriority(DMA1_Channel2_3_IRQn, 0, 0);
+  HAL_NVIC_EnableIRQ(DMA1_Channel2_3_IRQn);
+}
+
+/**
+  * @brief  Start streaming a frame.
+  * @param  out: frame to send
+  * @retval HAL_ERROR for an empty frame
+  */
+HAL_StatusTypeDef WS2812_Output_Start(const WS2812_OutputFrameTypeDef *out)
+{
+  frame = out;
+  halfSlots = WS2812_RING_PIXELS * 8U * out->channels;
+  stripPixels = (out->length + WS2812_DMAR_STRIPS - 1U) / WS2812_DMAR_STRIPS;
+  if (stripPixels == 0U)
+  {
+    return HAL_ERROR;
+  }
+
+  dataHalves = (stripPixels + WS2812_RING_PIXELS - 1U) / WS2812_RING_PIXELS;
+  lastHalf = dataHalves + (WS2812_LATCH_PERIODS + halfSlots - 1U) / halfSlots + 1U;
+  halvesDone = 0U;
+  WS2812_FillHalf(&ring[0], 0U);
+  WS2812_FillHalf(&ring[halfSlots], 1U);
+
+  /* Four bytes, one burst, per bit */
+  DMA1_Channel3->CMAR = (uint32_t)ring;
+  DMA1_Channel3->CNDTR = 2U * halfSlots * WS2812_DMAR_STRIPS;
+  DMA1_Channel3->CCR = DMA_CCR_PL_1 | DMA_CCR_PL_0 | DMA_CCR_PSIZE_0 |
+                       DMA_CCR_MINC | DMA_CCR_CIRC | DMA_CCR_DIR |
+                       DMA_CCR_HTIE | DMA_CCR_TCIE | DMA_CCR_EN;
+
+  /* The first tick wraps the counter : one idle bit, during which the
+     first burst fills the preload registers */
+  TIM3->SR = 0U;
+  TIM3->CNT = WS2812_BIT_TICKS - 1U;
+  TIM3->DIER = TIM_DIER_UDE;
+  TIM3->CR1 |= TIM_CR1_CEN;
+
+  return HAL_OK;
+}
+
+/**
+  * @brief  DMA1 Channel 3 interrupt : a ring half has been sent.
+  * @retval None
+  */
+void WS2812_Dmar_IRQHandler(void)
+{
+  uint32_t isr = DMA1->ISR;
+
+  /* One half per entry : the frame may end, and the next one start, here */
+  if (isr & DMA_ISR_HTIF3)
+  {
+    DMA1->IFCR = DMA_IFCR_CHTIF3;
+    WS2812_Refill(&ring[0]);
+  }
+  else if (isr & DMA_ISR_TCIF3)
+  {
+    DMA1->IFCR = DMA_IFCR_CTCIF3;
+    WS2812_Refill(&ring[halfSlots]);
+  }
+}
+
+#endif /* WS2812_OUTPUT == WS2812_OUTPUT_DMAR */
@@ -0,0 +1,310 @@
+/**
+  ******************************************************************************
+  * @file    ws2812_spi.c
+  * @brief   WS2812 output engine : one strip on SPI1 MOSI (PB5), DMA1
+  *          Channel 3, each bit sent as a 3 or 4-bit symbol.
+  ******************************************************************************
+  * SPI1 runs as a transmit-only master at 48 MHz / (2 << WS2812_SPI_BR),
+  * 3 MHz by default. A 1 is sent as 110(0) and a 0 as 100(0), so the high
+  * time is one or two SPI bits : 333 / 667 ns at 3 MHz, inside the WS2812B
+  * and SK6812 windows. The bit timing comes from the SPI clock, not from the
+  * chip profile : the build checks that both high times are within
+  * WS2812_SPI_TOLERANCE_NS of the profile's T0H / T1H, so that e.g. the
+  * WS2811 400 kHz profile, which no SPI rate meets, fails to compile.
+  *
+  * A colour byte becomes WS2812_SPI_SYMBOL_BITS bytes of symbols, looked up
+  * in a table : two halfword stores from a nibble table with 4-bit symbols,
+  * three byte stores from a byte table with 3-bit ones. That is 12 or 9 DMA
+  * bytes per RGB pixel, against 24 for TIM17, and a ring of 1 / 2 or 3 / 8
+  * its size.
+  *
+  * The ring is refilled on the half-transfer / transfer-complete interrupts
+  * and the latch is counted in zero halves, as for the other engines. MOSI
+  * stays low after the last zero byte, and the SPI is left running idle.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "ws2812_output.h"
+
+#if (WS2812_OUTPUT == WS2812_OUTPUT_SPI)
+
+#include "cycle_count.h"
+
+/* Private define ------------------------------------------------------------*/
+#if (WS2812_SPI_SYMBOL_BITS != 3U) && (WS2812_SPI_SYMBOL_BITS != 4U)
+#error "WS2812_SPI_SYMBOL_BITS must be 3 or 4"
+#endif
+
+#if (WS2812_SPI_BR > 7U)
+#error "WS2812_SPI_BR must be 0 to 7"
+#endif
+
+#define WS2812_SPI_KHZ          (WS2812_TIMER_MHZ * 1000U / (2U << WS2812_SPI_BR))
+
+/* High times of a 0 (one SPI bit) and a 1 (two) against the profile, within
+   the usual +/-150 ns of the datasheets */
+#ifndef WS2812_SPI_TOLERANCE_NS
+#define WS2812_SPI_TOLERANCE_NS 150U
+#endif
+#define WS2812_SPI_BIT_NS       (1000000U / WS2812_SPI_KHZ)
+
+#if (WS2812_SPI_BIT_NS + WS2812_SPI_TOLERANCE_NS < WS2812_T0H_NS) || \
+    (WS2812_SPI_BIT_NS > WS2812_T0H_NS + WS2812_SPI_TOLERANCE_NS)
+#error "SPI symbol 0 high time outside the profile's T0H window : change WS2812_SPI_BR or the output"
+#endif
+#if (2U * WS2812_SPI_BIT_NS + WS2812_SPI_TOLERANCE_NS < WS2812_T1H_NS) || \
+    (2U * WS2812_SPI_BIT_NS > WS2812_T1H_NS + WS2812_SPI_TOLERANCE_NS)
+#error "SPI symbol 1 high time outside the profile's T1H window : change WS2812_SPI_BR or the output"
+#endif
+
+/* Latch in SPI bytes, counted in ring halves once the data is out, plus one
+   half for the bytes still in the SPI FIFO */
+#define WS2812_LATCH_BYTES      ((WS2812_LATCH_US * WS2812_SPI_KHZ + 7999U) / 8000U)
+
+#if (WS2812_SPI_SYMBOL_BITS == 4U)
+/* Four symbols 1x00 of a nibble, MSB first, bytes swapped for a halfword store */
+#define WS2812_SYM(n, i)        ((((n) >> (3U - (i))) & 1UL) ? 0xCUL : 0x8UL)
+#define WS2812_NIBBLE(n)        ((WS2812_SYM(n, 0U) << 4) | WS2812_SYM(n, 1U) | \
+                                 (WS2812_SYM(n, 2U) << 12) | (WS2812_SYM(n, 3U) << 8))
+#else
+/* Eight symbols 1x0 of a byte, MSB first, in the low 24 bits */
+#define WS2812_SYM(b, i)        (((((b) >> (7U - (i))) & 1UL) ? 0x6UL : 0x4UL) << (21U - 3U * (i)))
+#define WS2812_BYTE(b)          (WS2812_SYM(b, 0U) | WS2812_SYM(b, 1U) | WS2812_SYM(b, 2U) | \
+                                 WS2812_SYM(b, 3U) | WS2812_SYM(b, 4U) | WS2812_SYM(b, 5U) | \
+                                 WS2812_SYM(b, 6U) | WS2812_SYM(b, 7U))
+#define WS2812_BYTE4(b)         WS2812_BYTE(b), WS2812_BYTE((b) + 1U), WS2812_BYTE((b) + 2U), WS2812_BYTE((b) + 3U)
+#define WS2812_BYTE16(b)        WS2812_BYTE4(b), WS2812_BYTE4((b) + 4U), WS2812_BYTE4((b) + 8U), WS2812_BYTE4((b) + 12U)
+#define WS2812_BYTE64(b)        WS2812_BYTE16(b), WS2812_BYTE16((b) + 16U), WS2812_BYTE16((b) + 32U), WS2812_BYTE16((b) + 48U)
+#endif
+
+/* Private variables ---------------------------------------------------------*/
+#if (WS2812_SPI_SYMBOL_BITS == 4U)
+static const uint16_t symbolLut[16] =
+{
+  WS2812_NIBBLE(0x0U), WS2812_NIBBLE(0x1U), WS2812_NIBBLE(0x2U), WS2812_NIBBLE(0x3U),
+  WS2812_NIBBLE(0x4U), WS2812_NIBBLE(0x5U), WS2812_NIBBLE(0x6U), WS2812_NIBBLE(0x7U),
+  WS2812_NIBBLE(0x8U), WS2812_NIBBLE(0x9U), WS2812_NIBBLE(0xAU), WS2812_NIBBLE(0xBU),
+  WS2812_NIBBLE(0xCU), WS2812_NIBBLE(0xDU), WS2812_NIBBLE(0xEU), WS2812_NIBBLE(0xFU),
+};
+#else
+static const uint32_t symbolLut[256] =
+{
+  WS2812_BYTE64(0U), WS2812_BYTE64(64U), WS2812_BYTE64(128U), WS2812_BYTE64(192U),
+};
+#endif
+
+/* Symbol bytes, halfword aligned for the 4-bit stores */
+static uint16_t ring[WS2812_OUTPUT_RING_BYTES / 2U];
+static const WS2812_OutputFrameTypeDef *frame;
+static uint32_t halfBytes;
+static uint32_t dataHalves;
+static uint32_t lastHalf;
+static volatile uint32_t halvesDone;
+
+/* Private function prototypes -----------------------------------------------*/
+static uint8_t *WS2812_EncodeByte(uint8_t *dst, uint8_t value);
+static uint32_t WS2812_FillHalf(uint8_t *dst, uint32_t seq);
+static void WS2812_Refill(uint8_t *half);
+
+/* Private user code ---------------------------------------------------------*/
+
+/**
+  * @brief  Expand one colour byte into its symbols, MSB first.
+  * @param  dst: first symbol byte to write
+  * @param  value: colour byte
+  * @retval Byte following the last one written
+  */
+static uint8_t *WS2812_EncodeByte(uint8_t *dst, uint8_t value)
+{
+#if (WS2812_SPI_SYMBOL_BITS == 4U)
+  uint16_t *out = (uint16_t *)dst;
+
+  out[0] = symbolLut[value >> 4];
+  out[1] = symbolLut[value & 0x0FU];
+  return dst + 4;
+#else
+  uint32_t symbols = symbolLut[value];
+
+  dst[0] = (uint8_t)(symbols >> 16);
+  dst[1] = (uint8_t)(symbols >> 8);
+  dst[2] = (uint8_t)symbols;
+  return dst + 3;
+#endif
+}
+
+/**
+  * @brief  Encode the seq-th half of the frame into a ring half.
+  *         Halves past the last pixel are filled with zeros (latch).
+  * @param  dst: ring half to fill
+  * @param  seq: index of the half in the frame
+  * @retval Number of pixels encoded
+  */
+static uint32_t WS2812_FillHalf(uint8_t *dst, uint32_t seq)
+{
+  uint8_t *end = dst + halfBytes;
+  uint32_t count = 0U;
+
+  if (seq < dataHalves)
+  {
+    const uint32_t channels = frame->channels;
+    const uint8_t *order = frame->order;
+    uint32_t first = seq * WS2812_RING_PIXELS;
+    uint32_t index = first * channels;
+
+    count = frame->length - first;
+    if (count > WS2812_RING_PIXELS)
+    {
+      count = WS2812_RING_PIXELS;
+    }
+
+    if (frame->dither)
+    {
+      for (uint32_t n = count; n != 0U; n--)
+      {
+        for (uint32_t c = 0; c < channels; c++)
+        {
+          dst = WS2812_EncodeByte(dst, WS2812_Output_Level(frame, index + order[c]));
+        }
+        index += channels;
+      }
+    }
+    else
+    {
+      const uint16_t *level = frame->level;
+      const uint8_t *px = (frame->fetch != NULL) ? frame->fetch(count * channels) : &frame->pixels[index];
+
+      for (uint32_t n = count; n != 0U; n--)
+      {
+        for (uint32_t c = 0; c < channels; c++)
+        {
+          dst = WS2812_EncodeByte(dst, (uint8_t)(level[px[order[c]]] >> 8));
+        }
+        px += channels;
+      }
+    }
+  }
+
+  while (dst < end)
+  {
+    *dst++ = 0U;
+  }
+
+  return count;
+}
+
+/**
+  * @brief  Called once a ring half has been clocked out.
+  * @param  half: the ring half that just finished
+  * @retval None
+  */
+static void WS2812_Refill(uint8_t *half)
+{
+  halvesDone++;
+
+  if (halvesDone >= lastHalf)
+  {
+    DMA1_Channel3->CCR &= ~DMA_CCR_EN;
+    DMA1->IFCR = DMA_IFCR_CGIF3;
+    WS2812_Output_Done();
+    return;
+  }
+
+  /* The other half is playing : this one carries the half after it */
+#if (WS2812_STATS != 0)
+  uint32_t start = CycleCount_Now();
+  uint32_t pixels = WS2812_FillHalf(half, halvesDone + 1U);
+  WS2812_Output_Account(CycleCount_Since(start), pixels);
+#else
+  WS2812_FillHalf(half, halvesDone + 1U);
+#endif
+}
+
+/**
+  * @brief  Set up MOSI, SPI1 and the DMA channel.
+  * @retval None
+  */
+void WS2812_Output_Init(void)
+{
+  GPIO_InitTypeDef GPIO_InitStruct = {0};
+
+  /* The SPI clock is derived from this one */
+  if (HAL_RCC_GetPCLK1Freq() != WS2812_TIMER_MHZ * 1000000U)
+  {
+    Error_Handler();
+  }
+
+  __HAL_RCC_GPIOB_CLK_ENABLE();
+  __HAL_RCC_SPI1_CLK_ENABLE();
+  __HAL_RCC_DMA1_CLK_ENABLE();
+
+  /* Master, software NSS, mode 0, 8-bit frames, MSB first, TX by DMA */
+  SPI1->CR1 = SPI_CR1_MSTR | SPI_CR1_SSM | SPI_CR1_SSI | (WS2812_SPI_BR << SPI_CR1_BR_Pos);
+  SPI1->CR2 = (7U << SPI_CR2_DS_Pos) | SPI_CR2_TXDMAEN;
+  SPI1->CR1 |= SPI_CR1_SPE;
+
+  /**SPI1 GPIO Configuration
+  PB5     ------> SPI1_MOSI
+  */
+  GPIO_InitStruct.Pin = GPIO_PIN_5;
+  GPIO_InitStruct.Mode = GPIO_MODE_AF_PP;
+  GPIO_InitStruct.Pull = GPIO_PULLDOWN;
+  GPIO_InitStruct.Speed = GPIO_SPEED_FREQ_HIGH;
+  GPIO_InitStruct.Alternate = GPIO_AF0_SPI1;
+  HAL_GPIO_Init(GPIOB, &GPIO_InitStruct);
+
+  /* Byte writes to DR : one frame per byte */
+  DMA1_Channel3->CPAR = (uint32_t)&SPI1->DR;
+
+  HAL_NVIC_SetPriority(DMA1_Channel2_3_IRQn, 0, 0);
+  HAL_NVIC_EnableIRQ(DMA1_Channel2_3_IRQn);
+}
+
+/**
+  * @brief  Start streaming a frame.
+  * @param  out: frame to send
+  * @retval HAL_OK
+  */
+HAL_StatusTypeDef WS2812_Output_Start(const WS2812_OutputFrameTypeDef *out)
+{
+  uint8_t *bytes = (uint8_t *)ring;
+
+  frame = out;
+  halfBytes = WS2812_RING_PIXELS * WS2812_SPI_SYMBOL_BITS * out->channels;
+  dataHalves = (out->length + WS2812_RING_PIXELS - 1U) / WS2812_RING_PIXELS;
+  lastHalf = dataHalves + (WS2812_LATCH_BYTES + halfBytes - 1U) / halfBytes + 1U;
+  halvesDone = 0U;
+  WS2812_FillHalf(&bytes[0], 0U);
+  WS2812_FillHalf(&bytes[halfBytes], 1U);
+
+  DMA1_Channel3->CMAR = (uint32_t)ring;
+  DMA1_Channel3->CNDTR = 2U * halfBytes;
+  DMA1_Channel3->CCR = DMA_CCR_PL_1 | DMA_CCR_MINC | DMA_CCR_CIRC | DMA_CCR_DIR |
+                       DMA_CCR_HTIE | DMA_CCR_TCIE | DMA_CCR_EN;
+
+  return HAL_OK;
+}
+
+/**
+  * @brief  DMA1 Channel 3 interrupt : a ring half has been sent.
+  * @retval None
+  */
+void WS2812_Spi_IRQHandler(void)
+{
+  uint32_t isr = DMA1->ISR;
+  uint8_t *bytes = (uint8_t *)ring;
+
+  /* One half per entry : the frame may end, and the next one start, here */
+  if (isr & DMA_ISR_HTIF3)
+  {
+    DMA1->IFCR = DMA_IFCR_CHTIF3;
+    WS2812_Refill(&bytes[0]);
+  }
+  else if (isr & DMA_ISR_TCIF3)
+  {
+    DMA1->IFCR = DMA_IFCR_CTCIF3;
+    WS2812_Refill(&bytes[halfBytes]);
+  }
+}
+
+#endif /* WS2812_OUTPUT == WS2812_OUTPUT_SPI */
@@ -0,0 +1,305 @@
+/**
+  ******************************************************************************
+  * @file    ws2812_tim17.c
+  * @brief   WS2812 output engine : one strip on TIM17 CH1 + DMA1 Channel1.
+  ******************************************************************************
+  * The DMA runs in circular mode over a ring of WS2812_RING_SLOTS compare
+  * values split in two halves. Each half-transfer / transfer-complete event
+  * means one half has just been clocked out : it is re-encoded with the next
+  * WS2812_RING_PIXELS pixels of the frame buffer while the other half plays.
+  * The DMA length follows the pixel format so a half always holds whole
+  * pixels ; the wire order of the channels is applied while encoding.
+  *
+  * Once every pixel is sent, one zero-duty half is streamed so the line is
+  * low, then the DMA is stopped and TIM17 holds the output forced low for the
+  * rest of the latch : it runs one-shot with the repetition counter set to the
+  * remaining bit periods, and its update interrupt ends the frame.
+  *
+  * The ring holds one byte per bit : the DMA reads bytes and writes halfwords,
+  * zero-extending each compare value into TIM17->CCR1. This halves the ring
+  * compared with a halfword buffer.
+  *
+  * Encoding goes through a nibble lookup table : each nibble gives one 32-bit
+  * word, i.e. four compare values, with no branch and no per-bit test. On the
+  * Cortex-M0 at 48 MHz this is about 7 cycles per nibble plus the channel
+  * reordering and level lookup, so roughly 80 cycles per RGB pixel (about 100
+  * with dithering), against 1440 cycles for a pixel on the wire at 800 kHz :
+  * the refill of a half costs well under 10 % of the time it takes to play it.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "ws2812_output.h"
+
+#if (WS2812_OUTPUT == WS2812_OUTPUT_TIM17)
+
+#include "cycle_count.h"
+
+/* Private define ------------------------------------------------------------*/
+/* Compare values for a 0 and a 1 bit, from the selected chip profile */
+#define WS2812_T0H              WS2812_T0H_TICKS
+#define WS2812_T1H              WS2812_T1H_TICKS
+
+/* Four byte slots packed in a word, first slot in the low byte */
+#define WS2812_SLOT(bit)        ((uint32_t)((bit) ? WS2812_T1H : WS2812_T0H))
+#define WS2812_NIBBLE(n)        (WS2812_SLOT((n) & 8U)         | (WS2812_SLOT((n) & 4U) << 8) | \
+                                 (WS2812_SLOT((n) & 2U) << 16) | (WS2812_SLOT((n) & 1U) << 24))
+
+/* Latch length in bit periods, part of it being the zero half streamed after
+   the last pixel (minus a slot of margin on each side). The shortest half,
+   for 3-channel pixels, is the worst case for the repetition counter. */
+#define WS2812_LATCH_PERIODS    ((WS2812_LATCH_US * WS2812_TIMER_MHZ + WS2812_BIT_TICKS - 1U) / WS2812_BIT_TICKS)
+#define WS2812_MIN_STREAMED     (WS2812_RING_PIXELS * 24U - 2U)
+
+#if (WS2812_LATCH_PERIODS > WS2812_MIN_STREAMED + 256U)
+#error "Latch too long for the TIM17 repetition counter"
+#endif
+
+#if (WS2812_BIT_TICKS > 256U)
+#error "Bit period too long for the byte-wide DMA ring"
+#endif
+
+/* Private variables ---------------------------------------------------------*/
+extern TIM_HandleTypeDef htim17;
+
+/* Four compare values per nibble, MSB first */
+static const uint32_t nibbleLut[16] =
+{
+  WS2812_NIBBLE(0x0U), WS2812_NIBBLE(0x1U), WS2812_NIBBLE(0x2U), WS2812_NIBBLE(0x3U),
+  WS2812_NIBBLE(0x4U), WS2812_NIBBLE(0x5U), WS2812_NIBBLE(0x6U), WS2812_NIBBLE(0x7U),
+  WS2812_NIBBLE(0x8U), WS2812_NIBBLE(0x9U), WS2812_NIBBLE(0xAU), WS2812_NIBBLE(0xBU),
+  WS2812_NIBBLE(0xCU), WS2812_NIBBLE(0xDU), WS2812_NIBBLE(0xEU), WS2812_NIBBLE(0xFU),
+};
+
+/* One byte per slot, word aligned so the encoder can store four at once */
+static uint32_t ring[WS2812_OUTPUT_RING_BYTES / 4U];
+static const WS2812_OutputFrameTypeDef *frame;
+static uint32_t halfWords;
+static uint32_t latchTimed;
+static uint32_t dataHalves;
+static volatile uint32_t halvesDone;
+
+/* Private function prototypes -----------------------------------------------*/
+static uint32_t *WS2812_EncodeByte(uint32_t *dst, uint8_t value);
+static uint32_t WS2812_FillHalf(uint32_t *dst, uint32_t seq);
+static void WS2812_Refill(uint32_t *half);
+static void WS2812_StartLatch(void);
+static void WS2812_EndLatch(void);
+
+/* Private user code ---------------------------------------------------------*/
+
+/**
+  * @brief  Expand one colour byte into 8 compare values, MSB first.
+  * @param  dst: first word of slots to write
+  * @param  value: colour byte
+  * @retval Word following the last one written
+  */
+static uint32_t *WS2812_EncodeByte(uint32_t *dst, uint8_t value)
+{
+  dst[0] = nibbleLut[value >> 4];
+  dst[1] = nibbleLut[value & 0x0FU];
+  return dst + 2;
+}
+
+/**
+  * @brief  Encode the seq-th half of the frame into a ring half.
+  *         Halves past the last pixel are filled with zero duty (latch).
+  * @param  dst: ring half to fill
+  * @param  seq: index of the half in the frame
+  * @retval Number of pixels encoded
+  */
+static uint32_t WS2812_FillHalf(uint32_t *dst, uint32_t seq)
+{
+  uint32_t *end = dst + halfWords;
+  uint32_t count = 0U;
+
+  if (seq < dataHalves)
+  {
+    const uint32_t channels = frame->channels;
+    const uint8_t *order = frame->order;
+    const uint16_t *level = frame->level;
+    uint32_t first = seq * WS2812_RING_PIXELS;
+    const uint8_t *px;
+
+    count = frame->length - first;
+    if (count > WS2812_RING_PIXELS)
+    {
+      count = WS2812_RING_PIXELS;
+    }
+    px = (frame->fetch != NULL) ? frame->fetch(count * channels) : &frame->pixels[first * channels];
+
+    if (frame->dither)
+    {
+      uint32_t index = first * channels;
+
+      for (uint32_t n = count; n != 0U; n--)
+      {
+        for (uint32_t c = 0; c < channels; c++)
+        {
+          dst = WS2812_EncodeByte(dst, WS2812_Output_Level(frame, index + order[c]));
+        }
+        index += channels;
+      }
+    }
+    else
+    {
+      /* Common case : wire order hoisted out of the loop, channels unrolled,
+         each byte read once and turned into slots in a single pass */
+      const uint32_t o0 = order[0];
+      const uint32_t o1 = order[1];
+      const uint32_t o2 = order[2];
+      const uint32_t o3 = order[3];
+
+      for (uint32_t n = count; n != 0U; n--)
+      {
+        dst = WS2812_EncodeByte(dst, (uint8_t)(level[px[o0]] >> 8));
+        dst = WS2812_EncodeByte(dst, (uint8_t)(level[px[o1]] >> 8));
+        dst = WS2812_EncodeByte(dst, (uint8_t)(level[px[o2]] >> 8));
+        if (channels == 4U)
+        {
+          dst = WS2812_EncodeByte(dst, (uint8_t)(level[px[o3]] >> 8));
+        }
+        px += channels;
+      }
+    }
+  }
+
+  while (dst < end)
+  {
+    *dst++ = 0U;
+  }
+
+  return count;
+}
+
+/**
+  * @brief  Called once a ring half has been clocked out.
+  * @param  half: the ring half that just finished
+  * @retval None
+  */
+static void WS2812_Refill(uint32_t *half)
+{
+  halvesDone++;
+
+  /* A whole zero half went out after the last pixel : the line is low */
+  if (halvesDone > dataHalves)
+  {
+    WS2812_StartLatch();
+    return;
+  }
+
+  /* The other half is playing : this one carries the half after it */
+#if (WS2812_STATS != 0)
+  uint32_t start = CycleCount_Now();
+  uint32_t pixels = WS2812_FillHalf(half, halvesDone + 1U);
+  WS2812_Output_Account(CycleCount_Since(start), pixels);
+#else
+  WS2812_FillHalf(half, halvesDone + 1U);
+#endif
+}
+
+/**
+  * @brief  Stop the DMA, hold the output low and let TIM17 time the rest
+  *         of the latch in one-pulse mode.
+  * @retval None
+  */
+static void WS2812_StartLatch(void)
+{
+  TIM_TypeDef *tim = htim17.Instance;
+
+  __HAL_TIM_DISABLE_DMA(&htim17, TIM_DMA_CC1);
+  HAL_DMA_Abort(htim17.hdma[TIM_DMA_ID_CC1]);
+
+  tim->CCMR1 = (tim->CCMR1 & ~TIM_CCMR1_OC1M) | TIM_OCMODE_FORCED_INACTIVE;
+
+  /* Reload the repetition counter now, without raising an update interrupt,
+     then stop the counter at the end of the latch */
+  tim->CR1 |= TIM_CR1_URS;
+  tim->RCR = latchTimed - 1U;
+  tim->EGR = TIM_EGR_UG;
+  tim->CR1 |= TIM_CR1_OPM;
+  __HAL_TIM_CLEAR_IT(&htim17, TIM_IT_UPDATE);
+  __HAL_TIM_ENABLE_IT(&htim17, TIM_IT_UPDATE);
+}
+
+/**
+  * @brief  Latch elapsed : TIM17 has stopped itself, restore it for the
+  *         next frame and hand back to the frame side.
+  * @retval None
+  */
+static void WS2812_EndLatch(void)
+{
+  TIM_TypeDef *tim = htim17.Instance;
+
+  __HAL_TIM_DISABLE_IT(&htim17, TIM_IT_UPDATE);
+  tim->CR1 &= ~TIM_CR1_OPM;
+  tim->RCR = 0U;
+  tim->CCR1 = 0U;
+  tim->EGR = TIM_EGR_UG;
+  tim->CCMR1 = (tim->CCMR1 & ~TIM_CCMR1_OC1M) | TIM_OCMODE_PWM1;
+
+  TIM_CHANNEL_STATE_SET(&htim17, TIM_CHANNEL_1, HAL_TIM_CHANNEL_STATE_READY);
+  WS2812_Output_Done();
+}
+
+/**
+  * @brief  Apply the chip profile to TIM17, once MX_TIM17_Init() has run.
+  * @retval None
+  */
+void WS2812_Output_Init(void)
+{
+  /* Profile ticks assume this timer clock */
+  if (HAL_RCC_GetPCLK1Freq() != WS2812_TIMER_MHZ * 1000000U)
+  {
+    Error_Handler();
+  }
+
+  __HAL_TIM_SET_AUTORELOAD(&htim17, WS2812_BIT_TICKS - 1U);
+  htim17.Instance->EGR = TIM_EGR_UG;
+}
+
+/**
+  * @brief  Start streaming a frame.
+  * @param  out: frame to send
+  * @retval HAL status
+  */
+HAL_StatusTypeDef WS2812_Output_Start(const WS2812_OutputFrameTypeDef *out)
+{
+  uint32_t halfSlots = WS2812_RING_PIXELS * 8U * out->channels;
+
+  frame = out;
+  halfWords = halfSlots / 4U;
+  latchTimed = (WS2812_LATCH_PERIODS > halfSlots - 2U) ? WS2812_LATCH_PERIODS - (halfSlots - 2U) : 1U;
+  dataHalves = (out->length + WS2812_RING_PIXELS - 1U) / WS2812_RING_PIXELS;
+  halvesDone = 0U;
+  WS2812_FillHalf(&ring[0], 0U);
+  WS2812_FillHalf(&ring[halfWords], 1U);
+
+  return HAL_TIM_PWM_Start_DMA(&htim17, TIM_CHANNEL_1, ring, 2U * halfSlots);
+}
+
+void HAL_TIM_PWM_PulseFinishedHalfCpltCallback(TIM_HandleTypeDef *htim)
+{
+  if (htim->Instance == TIM17)
+  {
+    WS2812_Refill(&ring[0]);
+  }
+}
+
+void HAL_TIM_PWM_PulseFinishedCallback(TIM_HandleTypeDef *htim)
+{
+  if (htim->Instance == TIM17)
+  {
+    WS2812_Refill(&ring[halfWords]);
+  }
+}
+
+void HAL_TIM_PeriodElapsedCallback(TIM_HandleTypeDef *htim)
+{
+  if (htim->Instance == TIM17)
+  {
+    WS2812_EndLatch();
+  }
+}
+
+#endif /* WS2812_OUTPUT == WS2812_OUTPUT_TIM17 */